@@ -0,0 +1,72 @@
+// A Stream that writes into a fixed buffer
+/*
+Copyright (c) 2024 Peter Martin www.naiadhome.com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <BufStream.h>
+
+BufStream::BufStream(char *buf, size_t size) : buf(buf), size(size) {
+    clear();
+}
+
+void BufStream::clear() {
+    len = 0;
+    overflow = false;
+    if (size) {
+        buf[0] = 0;
+    }
+}
+
+size_t BufStream::write(uint8_t v) {
+    return write(&v, 1);
+}
+
+size_t BufStream::write(const uint8_t *buffer, size_t n) {
+    size_t room = size ? size - 1 - len : 0;
+    if (n > room) {
+        n = room;
+        overflow = true;
+    }
+    memcpy(buf + len, buffer, n);
+    len += n;
+    if (size) {
+        buf[len] = 0;
+    }
+    return n;
+}
+
+int BufStream::availableForWrite() {
+    return size ? size - 1 - len : 0;
+}
+
+int BufStream::read() {
+    return 0;
+}
+
+int BufStream::available() {
+    return 0;
+}
+
+int BufStream::peek() {
+    return 0;
+}
+
+void BufStream::flush() {
+}
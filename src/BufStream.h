@@ -0,0 +1,54 @@
+// A Stream that writes into a fixed buffer
+/*
+Copyright (c) 2024 Peter Martin www.naiadhome.com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+// Writes text into a buffer supplied by the caller, so building text for
+// the displays does not touch the heap. Text that does not fit is dropped.
+class BufStream : public Stream {
+public:
+  BufStream(char *buf, size_t size);
+  /** Empty the buffer */
+  void clear();
+  /** The text written so far, always nul terminated */
+  const char *c_str() const { return buf; }
+  size_t length() const { return len; }
+  /** True if some text was dropped because the buffer was full */
+  bool truncated() const { return overflow; }
+
+  virtual size_t write(uint8_t);
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  virtual int availableForWrite(void);
+
+  virtual int available();
+  virtual int read();
+  virtual int peek();
+  virtual void flush();
+
+private:
+  char *buf;
+  size_t size;
+  size_t len;
+  bool overflow;
+};
@@ -2,91 +2,1041 @@
 
 #include <Arduino.h>
 #include <GwLogger.h>
+#include <GwPrefs.h>
+#include <SpscRing.h>
+#include <N2kCapture.h>
+#include <LogIndex.h>
 
 // Logfile name for the current operations
 static String logname;
 
-// How many old versions to keep
-static const uint16_t maxlogs = 10;
+// Set if logging is turned on and the logfile could be created
+static bool logEnabled = false;
 
-// The logfile base name
-String logbase = "logfile";
+// Logs are named log-SEQ-YYYYMMDD with a .txt or .n2k suffix. SEQ goes up by
+// one for each new file so the names sort in order. The date is the UTC day
+// the file was started and is left out if the clock was not set yet.
+#define LOG_PREFIX "log-"
+#define LOG_NAME_MAX 32
+
+// An empty file with its space already reserved, ready to become the next log
+#define LOG_SPARE "logspare.tmp"
 
 // The suffix. .txt works when reading on windows PCs
-String logsuffix = ".txt";
+static const char *logsuffix = ".txt";
+
+// The log writer. Records are gathered in RAM in 512 byte blocks, the card's
+// sector size, and a low priority task writes whole blocks to a file that is
+// kept open. The file is synced every LOG_SYNC_MS or LOG_SYNC_BYTES, whichever
+// comes first, so the directory and FAT are not rewritten for every record
+// and the main loop never waits for the card.
+#define LOG_BLOCK 512
+#define LOG_BLOCKS 16           // Must be a power of 2, one is always unused
+#ifndef LOG_SYNC_MS
+#define LOG_SYNC_MS 5000
+#endif
+#ifndef LOG_SYNC_BYTES
+#define LOG_SYNC_BYTES 16384
+#endif
+#define LOG_CORE 0              // The Arduino loop runs on core 1
+#define LOG_PRIORITY 1          // Below the ingest task
+#define LOG_STACK 4096
+
+// How often the main loop checks for a part filled block to hand over
+#define LOG_PERIOD 1000
+
+// Each log has its full size reserved in one contiguous run when it is
+// created, so the writer streams through sectors and the FAT is not updated
+// as the file grows. Halved until it fits on the card.
+#define LOG_PREALLOC_MIN (1024ULL * 1024)
+
+// The most a power cut can leave written but not synced
+#define LOG_RESCUE_MAX (LOG_SYNC_BYTES + LOG_BLOCKS * LOG_BLOCK)
+
+// How long close_log waits for the writer to finish
+#define LOG_CLOSE_MS 2000
+
+// A new file is started when the current one reaches the GWLOGSIZE limit or
+// the UTC day changes. The oldest files are deleted while all the logs take
+// more than GWLOGSPACE.
+#define LOG_MB (1024ULL * 1024)
+// The index holds 32 bit offsets, so a log must stay under 4GB
+#define LOG_SIZE_MAX (4095 * LOG_MB)
+static uint64_t logRotateBytes = 64 * LOG_MB;
+static uint64_t logSpace = 1024 * LOG_MB;
+
+struct LogBlock {
+  char data[LOG_BLOCK];
+  uint16_t len;
+  bool rotate;                  // Start the next file after this block
+};
+
+static SpscRing<LogBlock, LOG_BLOCKS> logRing;
+static LogBlock *logBlock;      // Block being filled by append_log
+static uint32_t blockStart;     // When the first record went into it
+static FsFile logFile;          // Only used by the writer task
+static TaskHandle_t logTaskHandle;
+static volatile bool logClosing;  // Set by close_log for the writer
+static volatile bool logClosed;   // Set by the writer once the file is closed
+
+// The current file as seen by the main loop
+static uint32_t logSeq;         // Sequence number
+static uint32_t logDay;         // UTC day it was started, 0 if not known
+static uint64_t fileBytes;      // Bytes put in it so far
+
+// The main loop starts a rotation and the writer finishes it
+static char nextName[LOG_NAME_MAX];
+static volatile bool logRotating;
+static uint64_t spareSize;      // Writer only, size the next spare is tried at, 0 if none is wanted
+static volatile bool logSparing;  // Set by the writer while it makes the spare
+
+// Index entries go to the writer in a ring of their own, each tagged with
+// the sequence number of the file it belongs to
+struct IndexSlot {
+  uint32_t seq;
+  uint8_t entry[LOG_INDEX_SIZE];
+};
+#define LOG_INDEX_SLOTS 32
+
+static SpscRing<IndexSlot, LOG_INDEX_SLOTS> indexRing;
+static FsFile indexFile;        // Only used by the writer task
+static uint32_t writerSeq;      // The file the writer has open
+static uint32_t indexRecords;   // Lines since the last entry
+static uint32_t indexMs;        // When the last entry was made
+static bool indexDue;           // The next line gets an entry
+
+// The format chosen at startup, and the encoder for binary logs
+static LogFormat logFormat = LOG_JSON;
+static N2kCapEncoder capture;
+
+#define LOG_DAY_SECS 86400
+
+static void logCopy(const void *data, size_t n);
+static uint32_t captureEpoch();
+static void startFile();
+static LogFormat logFormatPref();
+static void addIndex(uint32_t epoch, uint32_t ms);
+
+// Writer statistics
+static struct {
+  uint32_t records;       // Records logged
+  uint32_t dropped;       // Records lost because the ring was full
+  uint64_t bytes;         // Bytes logged
+  uint32_t blocks;        // Blocks written
+  uint32_t partial;       // Of which part filled
+  uint32_t syncs;
+  uint64_t sectors;       // Sectors the writes touched
+  uint32_t writeErrors;
+  uint64_t appendUs;      // Time the main loop spent in append_log
+  uint32_t appendMaxUs;
+  uint32_t writeMaxUs;    // Longest block write in the writer task
+  uint32_t syncMaxUs;     // Longest sync
+  uint64_t reserved;      // Space preallocated for the file
+  uint32_t rotations;
+  uint32_t rotateMaxUs;   // Longest file switch in the writer task
+  uint32_t pruned;        // Old logs deleted to stay within GWLOGSPACE
+  uint32_t rotateDropped; // Of those, lost while a file was switched or a spare made
+  uint32_t spareMaxUs;    // Longest step making the spare
+  uint32_t indexEntries;
+  uint32_t indexDropped;  // Entries lost because their ring was full
+} logStats;
+
+// What was done to the last run's log at startup
+static struct {
+  uint64_t rescued;       // Unsynced bytes taken back after a power cut
+  uint64_t trimmed;       // Part records cut from the end
+  uint64_t freed;         // Reserved space given back
+} logRecovery;
+
+// Hand the block being filled to the writer
+static void publishBlock() {
+  logRing.publish();
+  logBlock = NULL;
+  xTaskNotifyGive(logTaskHandle);
+}
+
+// Reserve contiguous space for a new, empty file. Returns the bytes reserved
+// or 0 if the file will have to grow as it is written.
+static uint64_t preallocate(FsFile &f, uint64_t size) {
+  for (; size >= LOG_PREALLOC_MIN; size /= 2) {
+    if (f.preAllocate(size)) {
+      return size;
+    }
+  }
+  return 0;
+}
+
+// The space a file holds on the card if it is in one run, else its size
+static uint64_t reservedSize(FsFile &f, uint32_t *firstSector = NULL) {
+  uint32_t first = 0;
+  uint32_t last = 0;
+  uint64_t size = f.fileSize();
+  if (f.contiguousRange(&first, &last)) {
+    size = (uint64_t)(last - first + 1) * LOG_BLOCK;
+  }
+  if (firstSector) {
+    *firstSector = first;
+  }
+  return size;
+}
+
+// The sequence number of a log file name, or 0 if it is not a log
+static uint32_t logSeqOf(const char *name) {
+  if (strncmp(name, LOG_PREFIX, strlen(LOG_PREFIX)) != 0) {
+    return 0;
+  }
+  char *end;
+  uint32_t seq = strtoul(name + strlen(LOG_PREFIX), &end, 10);
+  return *end == '-' || *end == '.' ? seq : 0;
+}
+
+// Name a log from its sequence number and the UTC time it starts, if known
+static void makeLogName(char *name, uint32_t seq, uint32_t epoch) {
+  if (epoch) {
+    time_t t = epoch;
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    snprintf(name, LOG_NAME_MAX, LOG_PREFIX "%05u-%04d%02d%02d%s", seq, tm.tm_year + 1900, tm.tm_mon + 1,
+             tm.tm_mday, logsuffix);
+  } else {
+    snprintf(name, LOG_NAME_MAX, LOG_PREFIX "%05u%s", seq, logsuffix);
+  }
+}
+
+// What scanLogs found on the card
+struct LogScan {
+  uint32_t count;
+  uint64_t bytes;
+  uint32_t first;               // Lowest and highest sequence numbers
+  uint32_t last;
+  char firstName[LOG_NAME_MAX];
+  char lastName[LOG_NAME_MAX];
+};
+
+// Find the logs on the card. The caller holds the SD lock.
+static void scanLogs(LogScan &scan) {
+  memset(&scan, 0, sizeof(scan));
+  FsFile dir;
+  FsFile entry;
+  if (!dir.open("/")) {
+    return;
+  }
+  while (entry.openNext(&dir, O_RDONLY)) {
+    char name[LOG_NAME_MAX];
+    entry.getName(name, sizeof(name));
+    uint32_t seq = logSeqOf(name);
+    if (seq && !entry.isDir() && !logIsIndex(name)) {
+      scan.count++;
+      scan.bytes += reservedSize(entry);
+      if (!scan.first || seq < scan.first) {
+        scan.first = seq;
+        strcpy(scan.firstName, name);
+      }
+      if (seq > scan.last) {
+        scan.last = seq;
+        strcpy(scan.lastName, name);
+      }
+    }
+    entry.close();
+  }
+  dir.close();
+}
+
+// Open a new log and its index. The spare file is used if there is one, as
+// its space is already reserved, otherwise the space is reserved now. The
+// caller holds the SD lock and is the writer, or runs before it starts.
+static bool openLog(FsFile &f, const char *name) {
+  char index[LOG_NAME_MAX];
+  logIndexName(index, sizeof(index), name);
+  indexFile.open(index, O_WRONLY | O_CREAT | O_TRUNC);
+  writerSeq = logSeqOf(name);
+
+  if (sd.exists(LOG_SPARE) && sd.rename(LOG_SPARE, name) && f.open(name, O_WRONLY)) {
+    logStats.reserved = reservedSize(f);
+    return true;
+  }
+  if (!f.open(name, O_WRONLY | O_CREAT | O_TRUNC)) {
+    return false;
+  }
+  logStats.reserved = preallocate(f, logRotateBytes);
+  return true;
+}
+
+// Finish the current file and carry on in the one the main loop named
+static void rotateFile() {
+  uint32_t start = micros();
+  {
+    SdLock lock;
+    logFile.truncate();
+    logFile.close();
+    indexFile.close();
+    if (!openLog(logFile, nextName)) {
+      logStats.writeErrors++;
+    }
+  }
+  logRotating = false;
+  spareSize = logRotateBytes;
+  logStats.rotations++;
+  uint32_t took = micros() - start;
+  if (took > logStats.rotateMaxUs) {
+    logStats.rotateMaxUs = took;
+  }
+}
 
-// Rotae the logs, losing the oldest and renaming the remaing files
-// so the oldest has the highest number
-void rotateLogs() {
-  String f1, f2;
+// One step of making the spare file. Each step tries a single size, and
+// a failed one is halved for the next step, so the blocks that arrive
+// meanwhile are written between the searches for free space.
+static void makeSpare() {
+  uint32_t start = micros();
+  logSparing = true;
+  {
+    SdLock lock;
+    FsFile f;
+    if (sd.exists(LOG_SPARE) || !f.open(LOG_SPARE, O_WRONLY | O_CREAT | O_TRUNC)) {
+      spareSize = 0;
+    } else {
+      bool reserved = f.preAllocate(spareSize);
+      f.close();
+      if (reserved) {
+        spareSize = 0;
+      } else {
+        sd.remove(LOG_SPARE);
+        spareSize = spareSize / 2 >= LOG_PREALLOC_MIN ? spareSize / 2 : 0;
+      }
+    }
+  }
+  logSparing = false;
+  uint32_t took = micros() - start;
+  if (took > logStats.spareMaxUs) {
+    logStats.spareMaxUs = took;
+  }
+}
 
-  // remove the oldest file
-  f1 = logbase + maxlogs + logsuffix;
-  if(sd.exists(f1)) {
-    sd.remove(f1);
+// Work the writer does when it has no blocks waiting. It makes the next
+// spare file, then deletes the oldest logs while they take too much space.
+// One step at a time so new blocks never wait long. Returns true while
+// there is more to do.
+static bool logTidy() {
+  if (spareSize) {
+    makeSpare();
+    return true;
+  }
+  SdLock lock;
+  LogScan scan;
+  scanLogs(scan);
+  // The current log is counted at its reserved size, so allow for the spare
+  if (scan.count > 1 && scan.bytes + logRotateBytes > logSpace) {
+    char index[LOG_NAME_MAX];
+    logIndexName(index, sizeof(index), scan.firstName);
+    sd.remove(scan.firstName);
+    sd.remove(index);
+    logStats.pruned++;
+    return true;
   }
+  return false;
+}
 
-// rename the old logs moving them to their next highest number
-  for(uint16_t i = maxlogs; i > 1; i--) {
-    f1 = logbase + i + logsuffix;
-    f2 = logbase + (i-1) + logsuffix;
-    if(sd.exists(f2)) {
-      sd.rename(f2, f1);
-      Serial.printf("Renaming %s to %s\n", f2.c_str() , f1.c_str());
+// Write the index entries queued for the file that is open. Those for an
+// earlier file are too late and are dropped, and those for the next wait.
+static void writeIndex() {
+  IndexSlot *slot;
+  while ((slot = indexRing.front()) != NULL && slot->seq <= writerSeq) {
+    if (slot->seq == writerSeq) {
+      SdLock lock;
+      indexFile.write(slot->entry, LOG_INDEX_SIZE);
     }
+    indexRing.pop();
   }
-  // rename the old log with 1st sequence
-  sd.rename(logbase + logsuffix, logbase + 1 + logsuffix);
+}
+
+// Write whatever blocks are ready and sync when due
+static void logTask(void *param) {
+  uint32_t unsynced = 0;
+  uint32_t lastSync = millis();
+  uint64_t pos = 0;
+  bool tidy = true;
+  for (;;) {
+    // Tidying goes a step at a time, blocking for a tick between steps so
+    // the idle task on this core still runs and feeds the watchdog
+    ulTaskNotifyTake(pdTRUE, tidy ? 1 : pdMS_TO_TICKS(LOG_SYNC_MS));
+    LogBlock *block;
+    while ((block = logRing.front()) != NULL) {
+      uint32_t start = micros();
+      size_t written;
+      {
+        SdLock lock;
+        written = logFile.write(block->data, block->len);
+      }
+      uint32_t took = micros() - start;
+      if (written != block->len) {
+        logStats.writeErrors++;
+      }
+      if (took > logStats.writeMaxUs) {
+        logStats.writeMaxUs = took;
+      }
+      logStats.blocks++;
+      if (block->len < LOG_BLOCK) {
+        logStats.partial++;
+      }
+      logStats.sectors += (pos + block->len + LOG_BLOCK - 1) / LOG_BLOCK - pos / LOG_BLOCK;
+      pos += block->len;
+      unsynced += block->len;
+      bool rotate = block->rotate;
+      logRing.pop();
+      if (rotate) {
+        writeIndex();
+        rotateFile();
+        pos = 0;
+        unsynced = 0;
+        lastSync = millis();
+        tidy = true;
+      }
+    }
+    writeIndex();
+    if (unsynced >= LOG_SYNC_BYTES || (unsynced && millis() - lastSync >= LOG_SYNC_MS)) {
+      uint32_t start = micros();
+      {
+        SdLock lock;
+        logFile.sync();
+        indexFile.sync();
+      }
+      uint32_t took = micros() - start;
+      if (took > logStats.syncMaxUs) {
+        logStats.syncMaxUs = took;
+      }
+      logStats.syncs++;
+      unsynced = 0;
+      lastSync = millis();
+    }
+    if (logClosing && !logRing.front()) {
+      // Cut off the unused reserved space and finish
+      SdLock lock;
+      logFile.truncate();
+      logFile.close();
+      indexFile.close();
+      logClosed = true;
+      vTaskDelete(NULL);
+    }
+    if (tidy && !logRing.front()) {
+      tidy = logTidy();
+    }
+  }
+}
+
+// Where a capture read back after a power cut should end. buf holds the end
+// of the file. Its first synced bytes are known to be good and the rest was
+// read from the card past the end of the file, so is only kept up to a sync
+// marker whose CRC matches. Otherwise the capture ends at its last whole
+// record. If the synced bytes are damaged they are left alone.
+static size_t captureEnd(const uint8_t *buf, size_t len, size_t synced, bool fromHeader) {
+  // Records can only be found from the header or a sync marker
+  size_t p = synced;
+  if (fromHeader) {
+    p = N2KCAP_HEADER_SIZE;
+  } else {
+    do {
+      if (p == 0) {
+        return synced;
+      }
+      p--;
+    } while (buf[p] != N2KCAP_SYNC || len - p < N2KCAP_SYNC_SIZE ||
+             memcmp(buf + p + 1, N2KCAP_SYNC_MAGIC, 4) != 0);
+    p += N2KCAP_SYNC_SIZE;
+  }
+
+  size_t start = p;       // Where the CRC of the next marker starts
+  size_t whole = p;       // End of the last whole record in the synced bytes
+  size_t verified = 0;    // End of the last good marker past them
+  bool damaged = false;
+  while (p < len) {
+    if (buf[p] == N2KCAP_SYNC) {
+      if (len - p < N2KCAP_SYNC_SIZE) {
+        break;
+      }
+      if (memcmp(buf + p + 1, N2KCAP_SYNC_MAGIC, 4) != 0 ||
+          n2kcapCrc32(0, buf + start, p - start) != n2kcapGet32(buf + p + 17)) {
+        damaged = true;
+        break;
+      }
+      p += N2KCAP_SYNC_SIZE;
+      start = p;
+    } else {
+      uint32_t delta;
+      size_t n = buf[p] <= N2KCAP_MAX_DATA ? n2kcapRecord(buf + p, len - p, delta) : 0;
+      if (!n) {
+        damaged = buf[p] > N2KCAP_MAX_DATA || len - p >= N2KCAP_MAX_RECORD;
+        break;
+      }
+      p += n;
+    }
+    if (p <= synced) {
+      whole = p;
+    } else if (p == start) {
+      verified = p;
+    }
+  }
+  if (damaged && p < synced) {
+    return synced;
+  }
+  return verified ? verified : whole;
+}
+
+// A text log ends after its last whole line
+static size_t textEnd(const uint8_t *buf, size_t len) {
+  for (size_t p = len; p > 0; p--) {
+    if (buf[p - 1] == '\n') {
+      return p;
+    }
+  }
+  return len;
+}
+
+// Tidy the log left by the last run. If the power was cut it still has all
+// its reserved space and the data written since the last sync is on the card
+// past the end of the file. That is taken back for binary logs, where the
+// CRCs show it is from this file. Then the file is cut to its last whole
+// record, freeing the rest of the space.
+static void recoverLog(const String &name) {
+  SdLock lock;
+  FsFile f;
+  if (!sd.exists(name.c_str()) || !f.open(name.c_str(), O_RDWR)) {
+    return;
+  }
+  uint64_t size = f.fileSize();
+  uint32_t firstSector;
+  uint64_t allocated = reservedSize(f, &firstSector);
+
+  char magic[6];
+  bool binary = size >= N2KCAP_HEADER_SIZE && f.read(magic, 6) == 6 && memcmp(magic, N2KCAP_MAGIC, 6) == 0;
+  uint64_t tail = binary ? N2KCAP_SYNC_BYTES + N2KCAP_MAX_OUT : LOG_BLOCK;
+  tail = size > tail ? size - tail : 0;
+  size_t synced = size - tail;
+  size_t rescue = 0;
+  if (binary && firstSector && allocated > size) {
+    rescue = allocated - size < LOG_RESCUE_MAX ? allocated - size : LOG_RESCUE_MAX;
+  }
+
+  uint64_t end = size;
+  uint8_t *buf = (uint8_t *)malloc(synced + rescue);
+  if (buf && f.seekSet(tail) && f.read(buf, synced) == (int)synced) {
+    // Read the sectors past the end straight from the card
+    size_t len = synced;
+    uint8_t sector[LOG_BLOCK];
+    for (uint64_t pos = size; len < synced + rescue; pos += LOG_BLOCK - pos % LOG_BLOCK) {
+      if (!sd.card()->readSector(firstSector + pos / LOG_BLOCK, sector)) {
+        break;
+      }
+      size_t n = LOG_BLOCK - pos % LOG_BLOCK;
+      if (n > synced + rescue - len) {
+        n = synced + rescue - len;
+      }
+      memcpy(buf + len, sector + pos % LOG_BLOCK, n);
+      len += n;
+    }
+    end = tail + (binary ? captureEnd(buf, len, synced, tail == 0) : textEnd(buf, len));
+    if (end > size) {
+      f.seekSet(size);
+      f.write(buf + synced, end - size);
+      logRecovery.rescued += end - size;
+    } else {
+      logRecovery.trimmed += size - end;
+    }
+  }
+  free(buf);
+
+  if (end != size || allocated > size) {
+    Serial.printf("Recovering %s, %llu bytes long, %llu bytes of data\n", name.c_str(), size, end);
+    if (allocated > end) {
+      logRecovery.freed += allocated - end;
+    }
+  }
+  f.truncate(end);
+  f.close();
 }
 
 void setup_logging(void) {
-    rotateLogs();
-    logname = logbase + logsuffix;
+  logFormat = logFormatPref();
+  if (logFormat == LOG_BINARY) {
+    logsuffix = ".n2k";
+  }
+  uint64_t size = GwGetVal(GWLOGSIZE, "64").toInt() * LOG_MB;
+  logRotateBytes = size < LOG_PREALLOC_MIN ? LOG_PREALLOC_MIN : size > LOG_SIZE_MAX ? LOG_SIZE_MAX : size;
+  logSpace = GwGetVal(GWLOGSPACE, "1024").toInt() * LOG_MB;
+
+  if(!hasSdCard() || GwGetVal(GWLOG, "on") == "off") {
+    return;
+  }
+
+  // Tidy up the last run's log and carry on from its sequence number
+  LogScan scan;
+  {
+    SdLock lock;
+    scanLogs(scan);
+  }
+  if (scan.count) {
+    recoverLog(scan.lastName);
+  }
+  logSeq = scan.last + 1;
+  uint32_t epoch = captureEpoch();
+  logDay = epoch / LOG_DAY_SECS;
+  char name[LOG_NAME_MAX];
+  makeLogName(name, logSeq, epoch);
+  logname = name;
 
-    if(!hasSdCard()) {
+  // The file stays open for the writer task
+  {
+    SdLock lock;
+    if (!openLog(logFile, name)) {
+      errorPrint("Creating logfile");
       return;
     }
+  }
+  spareSize = logRotateBytes;
+  xTaskCreatePinnedToCore(logTask, "logger", LOG_STACK, NULL,
+                          LOG_PRIORITY, &logTaskHandle, LOG_CORE);
+  logEnabled = true;
+  startFile();
+}
+
+// True if records should be built and logged
+bool loggingActive() {
+  return logEnabled && hasSdCard();
+}
+
+LogFormat getLogFormat() {
+  return logFormat;
+}
+
+// The format the GWLOGFMT preference asks for
+static LogFormat logFormatPref() {
+  return GwGetVal(GWLOGFMT, "json") == "bin" ? LOG_BINARY : LOG_JSON;
+}
+
+// True if a binary log will be written, so the ingest filter must pass
+// every PGN rather than just the decoded ones. Can be called before
+// setup_logging.
+bool logCapturesAll() {
+  return logFormatPref() == LOG_BINARY && GwGetVal(GWLOG, "on") != "off";
+}
+
+// Start a new block. logHasRoom must have been checked first.
+static void claimBlock() {
+  logBlock = logRing.claim();
+  logBlock->len = 0;
+  logBlock->rotate = false;
+  blockStart = millis();
+}
+
+// True if n more bytes fit in the current block and the free ones
+static bool logHasRoom(size_t n) {
+  size_t room = logBlock ? LOG_BLOCK - logBlock->len : 0;
+  size_t spare = (logRing.capacity() - logRing.size() - (logBlock ? 1 : 0)) * LOG_BLOCK;
+  return n <= room + spare;
+}
 
-// create a file and write one line to the file
-  if (!file.open(logname.c_str(), O_WRONLY | O_CREAT | O_TRUNC)) {
-    errorPrint("Creating logfile");
+// Copy bytes into the blocks, handing each one to the writer as it fills.
+// logHasRoom must have been checked first.
+static void logCopy(const void *data, size_t n) {
+  const char *p = (const char *)data;
+  while (n) {
+    if (!logBlock) {
+      claimBlock();
+    }
+    size_t chunk = LOG_BLOCK - logBlock->len;
+    if (chunk > n) {
+      chunk = n;
+    }
+    memcpy(logBlock->data + logBlock->len, p, chunk);
+    logBlock->len += chunk;
+    fileBytes += chunk;
+    p += chunk;
+    n -= chunk;
+    if (logBlock->len == LOG_BLOCK) {
+      publishBlock();
+    }
+  }
+}
+
+// Count a record and the main loop time it took
+static void logCounted(size_t bytes, uint32_t start) {
+  logStats.records++;
+  logStats.bytes += bytes;
+
+  uint32_t took = micros() - start;
+  logStats.appendUs += took;
+  if (took > logStats.appendMaxUs) {
+    logStats.appendMaxUs = took;
+  }
+}
+
+// Queue an index entry for the point the current file has reached
+static void addIndex(uint32_t epoch, uint32_t ms) {
+  indexRecords = 0;
+  indexMs = ms;
+  indexDue = false;
+  IndexSlot *slot = indexRing.claim();
+  if (!slot) {
+    logStats.indexDropped++;
     return;
   }
-  file.println(logname);
-  file.close();
+  LogIndexEntry e = {epoch, ms, (uint32_t)fileBytes};
+  slot->seq = logSeq;
+  logIndexPut(slot->entry, e);
+  indexRing.publish();
+  logStats.indexEntries++;
 }
 
+// Count a record lost because the blocks were full, and whether the writer
+// was busy switching files or making the spare at the time
+static void logDropped() {
+  logStats.dropped++;
+  if (logRotating || logSparing) {
+    logStats.rotateDropped++;
+  }
+}
+
+// Add a line to the log. It is copied into the current block and only
+// reaches the card once the block is full or has waited too long.
 void append_log(const char * msg) {
-     if(!hasSdCard()) {
-      return;
+  if (!loggingActive()) {
+    return;
+  }
+  uint32_t start = micros();
+  size_t len = strlen(msg);
+
+  // Make sure the whole line will fit before adding any of it
+  if (!logHasRoom(len + 2)) {
+    logDropped();
+    return;
+  }
+  if (indexDue || ++indexRecords >= LOG_INDEX_RECORDS || millis() - indexMs >= LOG_INDEX_MS) {
+    addIndex(captureEpoch(), millis());
+  }
+  logCopy(msg, len);
+  logCopy("\r\n", 2);
+  logCounted(len + 2, start);
+}
+
+// UTC seconds for the capture, or 0 if the clock has not been set yet
+static uint32_t captureEpoch() {
+  time_t now = time(NULL);
+  return now > LOG_CLOCK_SET ? now : 0;
+}
+
+// Add a message to a binary log as it arrived
+void capture_log(const tN2kMsg &msg) {
+  if (!loggingActive()) {
+    return;
+  }
+  uint32_t start = micros();
+
+  // Check for room before encoding as the encoder keeps a CRC of what it
+  // has written, which would not match if the frame were then dropped
+  if (!logHasRoom(N2KCAP_MAX_OUT)) {
+    logDropped();
+    return;
+  }
+  uint8_t buf[N2KCAP_MAX_OUT];
+  uint32_t canId = n2kcapCanId(msg.Priority, msg.PGN, msg.Source, msg.Destination);
+  uint32_t ms = millis();
+  uint32_t epoch = captureEpoch();
+  size_t n = capture.frame(buf, ms, epoch, canId, msg.Data, msg.DataLen);
+
+  // Each sync marker is indexed. When messages are sparse a marker is added
+  // so there is still an entry every LOG_INDEX_MS.
+  if (capture.pending() && ms - indexMs >= LOG_INDEX_MS) {
+    n += capture.sync(buf + n);
+  }
+  logCopy(buf, n);
+  if (!capture.pending()) {
+    addIndex(epoch, ms);
+  }
+  logCounted(n, start);
+}
+
+// Start the current file with a capture header, or a line with its name
+static void startFile() {
+  fileBytes = 0;
+  if (logFormat == LOG_BINARY) {
+    uint8_t header[N2KCAP_HEADER_SIZE];
+    uint32_t epoch = captureEpoch();
+    uint32_t ms = millis();
+    logCopy(header, capture.header(header, epoch, ms));
+    addIndex(epoch, ms);
+  } else {
+    indexDue = true;
+    append_log(logname.c_str());
+  }
+}
+
+// Move on to a new file, between records. The block being filled is marked
+// as the last of the old file and the writer task switches files when it
+// gets to it, so the main loop never waits for the card. Tried again on
+// the next logWork if the blocks are too full.
+static void rotateLog(uint32_t epoch) {
+  if (!logHasRoom(N2KCAP_SYNC_SIZE + 2 * LOG_BLOCK)) {
+    return;
+  }
+  if (logFormat == LOG_BINARY) {
+    uint8_t marker[N2KCAP_SYNC_SIZE];
+    logCopy(marker, capture.sync(marker));
+  }
+  if (!logBlock) {
+    claimBlock();
+  }
+  logSeq++;
+  logDay = epoch / LOG_DAY_SECS;
+  makeLogName(nextName, logSeq, epoch);
+  logname = nextName;
+  logRotating = true;
+  logBlock->rotate = true;
+  publishBlock();
+  startFile();
+}
+
+// Finish the log before a restart. The last records are written, a binary
+// log gets a closing sync marker, and the unused reserved space is freed.
+void close_log() {
+  if (!loggingActive()) {
+    return;
+  }
+  if (logFormat == LOG_BINARY && logHasRoom(N2KCAP_SYNC_SIZE)) {
+    uint8_t marker[N2KCAP_SYNC_SIZE];
+    logCopy(marker, capture.sync(marker));
+  }
+  logEnabled = false;
+  if (logBlock && logBlock->len) {
+    publishBlock();
+  }
+  logClosing = true;
+  xTaskNotifyGive(logTaskHandle);
+  uint32_t start = millis();
+  while (!logClosed && millis() - start < LOG_CLOSE_MS) {
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+}
+
+// Hand over a part filled block that has waited long enough, so the log
+// is never more than about LOG_SYNC_MS behind when messages are sparse.
+uint32_t logWork() {
+  if (loggingActive() && !logRotating) {
+    uint32_t epoch = captureEpoch();
+    if (fileBytes >= logRotateBytes || epoch / LOG_DAY_SECS != logDay) {
+      rotateLog(epoch);
     }
+  }
+  if (logBlock && logBlock->len && millis() - blockStart >= LOG_SYNC_MS) {
+    publishBlock();
+  }
+  return LOG_PERIOD;
+}
+
+// Show how well the writer is doing
+void getLogStats(Stream &s) {
+  if (!loggingActive()) {
+    s.printf("Logging is off\n");
+    return;
+  }
+  s.printf("Logfile     %s\n", logname.c_str());
+  s.printf("Files       %llu of %llu bytes used, %u rotations, %u pruned, %u us max switch\n", fileBytes,
+           logRotateBytes, logStats.rotations, logStats.pruned, logStats.rotateMaxUs);
+  s.printf("Index       %u entries, %u dropped\n", logStats.indexEntries, logStats.indexDropped);
+  s.printf("Records     %u logged, %u dropped, %llu bytes\n", logStats.records, logStats.dropped,
+           logStats.bytes);
+  s.printf("Rotation    %u dropped while switching files or making the spare, %u us max spare step\n",
+           logStats.rotateDropped, logStats.spareMaxUs);
+  s.printf("Blocks      %u written, %u part filled, %u write errors, %u of %u queued\n",
+           logStats.blocks, logStats.partial, logStats.writeErrors, (unsigned)logRing.size(),
+           (unsigned)logRing.capacity());
+  s.printf("Syncs       %u, every %u ms or %u bytes\n", logStats.syncs, LOG_SYNC_MS, LOG_SYNC_BYTES);
+  uint32_t amp = logStats.bytes ? logStats.sectors * LOG_BLOCK * 100 / logStats.bytes : 0;
+  s.printf("Sectors     %llu written, amplification %u.%02u\n", logStats.sectors, amp / 100, amp % 100);
+  uint32_t mean = logStats.records ? logStats.appendUs / logStats.records : 0;
+  s.printf("Main loop   %u us mean, %u us max in append_log\n", mean, logStats.appendMaxUs);
+  s.printf("Writer      %u us max write, %u us max sync\n", logStats.writeMaxUs, logStats.syncMaxUs);
+  s.printf("Reserved    %llu bytes%s\n", logStats.reserved, logStats.reserved ? "" : ", file grows as written");
+  s.printf("Recovered   %llu bytes, %llu trimmed, %llu freed at startup\n", logRecovery.rescued,
+           logRecovery.trimmed, logRecovery.freed);
+}
 
-    if (!file.open(logname.c_str(), O_WRONLY | O_CREAT | O_APPEND)) {
-        errorPrint("Updating logfile");
+// Compare the old way of writing, growing the file, with a preallocated file.
+// Writes records of 100 bytes to a scratch file in blocks and syncs the way
+// the writer does. Takes the card for a few seconds, so is only for testing.
+void benchLog(Stream &s, uint32_t records) {
+  static const char name[] = "logbench.tmp";
+  char line[100];
+  memset(line, 'x', sizeof(line) - 2);
+  line[sizeof(line) - 2] = '\r';
+  line[sizeof(line) - 1] = '\n';
+
+  for (int prealloc = 0; prealloc < 2; prealloc++) {
+    FsFile f;
+    {
+      SdLock lock;
+      if (!f.open(name, O_WRONLY | O_CREAT | O_TRUNC)) {
+        s.printf("Cannot create %s\n", name);
         return;
+      }
+      if (prealloc && !preallocate(f, (uint64_t)records * sizeof(line))) {
+        s.printf("Cannot preallocate %u bytes\n", records * (uint32_t)sizeof(line));
+      }
+    }
+    char block[LOG_BLOCK];
+    size_t len = 0;
+    uint32_t unsynced = 0;
+    uint32_t errors = 0;
+    uint32_t start = millis();
+    for (uint32_t i = 0; i < records; i++) {
+      for (size_t done = 0; done < sizeof(line);) {
+        size_t n = sizeof(line) - done < LOG_BLOCK - len ? sizeof(line) - done : LOG_BLOCK - len;
+        memcpy(block + len, line + done, n);
+        len += n;
+        done += n;
+        if (len == LOG_BLOCK) {
+          SdLock lock;
+          if (f.write(block, len) != len) {
+            errors++;
+          }
+          len = 0;
+          unsynced += LOG_BLOCK;
+          if (unsynced >= LOG_SYNC_BYTES) {
+            f.sync();
+            unsynced = 0;
+          }
+        }
+      }
     }
+    SdLock lock;
+    f.write(block, len);
+    f.truncate();
+    f.close();
+    uint32_t took = millis() - start;
+    sd.remove(name);
+    s.printf("%-12s %u records in %u ms, %u records/s, %u write errors\n", prealloc ? "Preallocated" : "Growing",
+             records, took, took ? (uint32_t)((uint64_t)records * 1000 / took) : 0, errors);
+  }
+}
 
-  file.println(msg);
-  file.close();
-  file.sync();
+// Read entry i of an index. The caller holds the SD lock.
+static bool readIndex(FsFile &f, uint32_t i, LogIndexEntry &e) {
+  uint8_t buf[LOG_INDEX_SIZE];
+  if (!f.seekSet((uint64_t)i * LOG_INDEX_SIZE) || f.read(buf, LOG_INDEX_SIZE) != LOG_INDEX_SIZE) {
+    return false;
+  }
+  logIndexGet(buf, e);
+  return true;
 }
 
-void read_log(String &log, Stream & s) {
-    if(!hasSdCard()) {
-      return;
+// The first of count index entries later than t, found by bisection so
+// only a few entries are read from the card
+static uint32_t indexAfter(FsFile &f, uint32_t count, uint32_t t) {
+  uint32_t lo = 0;
+  uint32_t hi = count;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    LogIndexEntry e;
+    if (!readIndex(f, mid, e)) {
+      return count;
     }
-    
-    if (!file.open(log.c_str(), O_RDWR)) {
-        errorPrint("Updating logfile");
-        return;
+    if (e.epoch <= t) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
     }
+  }
+  return lo;
+}
 
-    String str;
-    do {
-        str = file.readString();
-        s.print(str);
-    } while(str.length());
-    file.close();
+// Find the part of a log from the index entry at or before from, to the
+// first entry after to. Without an index, or if the log was written before
+// the clock was set, the range is the whole log.
+bool findLogRange(const char *name, uint32_t from, uint32_t to, LogRange &range) {
+  SdLock lock;
+  FsFile f;
+  if (!f.open(name, O_RDONLY)) {
+    return false;
+  }
+  uint64_t size = f.fileSize();
+  char magic[6];
+  range.binary = f.read(magic, 6) == 6 && memcmp(magic, N2KCAP_MAGIC, 6) == 0;
+  range.start = 0;
+  range.end = size;
+  range.epoch = 0;
+  range.ms = 0;
+  f.close();
+
+  char index[64];
+  logIndexName(index, sizeof(index), name);
+  if (!f.open(index, O_RDONLY)) {
+    return true;
+  }
+  uint32_t count = f.fileSize() / LOG_INDEX_SIZE;
+  LogIndexEntry e;
+  if (count && readIndex(f, count - 1, e) && e.epoch) {
+    uint32_t i = indexAfter(f, count, from);
+    if (i > 0 && readIndex(f, i - 1, e) && e.offset < size) {
+      range.start = e.offset;
+      range.epoch = e.epoch;
+      range.ms = e.ms;
+    }
+    i = indexAfter(f, count, to);
+    if (i < count && readIndex(f, i, e) && e.offset >= range.start && e.offset < size) {
+      range.end = e.offset;
+    }
+  }
+  f.close();
+  return true;
+}
+
+// A binary range that starts part way through a capture needs a header of
+// its own, with the time of the sync marker it starts after. Fills in buf,
+// which has room for N2KCAP_HEADER_SIZE bytes, and returns the size or 0.
+size_t logRangeHeader(const LogRange &range, uint8_t *buf) {
+  if (!range.binary || range.start == 0) {
+    return 0;
+  }
+  N2kCapEncoder encoder;
+  return encoder.header(buf, range.epoch, range.ms);
+}
+
+// Read a time for a range. UTC as 2024-07-28T10:00 where the time or the
+// seconds can be left off and a space can replace the T, seconds since
+// 1970, or back from now as -30m, -2h or -1d.
+bool parseLogTime(const char *s, uint32_t &epoch) {
+  char *end;
+  if (s[0] == '-') {
+    uint32_t n = strtoul(s + 1, &end, 10);
+    uint32_t unit = 0;
+    switch (*end) {
+      case 's': unit = 1; break;
+      case 'm': unit = 60; break;
+      case 'h': unit = 3600; break;
+      case 'd': unit = 86400; break;
+    }
+    uint32_t now = captureEpoch();
+    if (end == s + 1 || !unit || end[1] || !now) {
+      return false;
+    }
+    epoch = now - n * unit;
+    return true;
+  }
+  int year, month, day;
+  int hour = 0;
+  int minute = 0;
+  int second = 0;
+  if (sscanf(s, "%d-%d-%d%*[T ]%d:%d:%d", &year, &month, &day, &hour, &minute, &second) >= 3) {
+    if (year < 1970 || month < 1 || month > 12 || day < 1 || day > 31) {
+      return false;
+    }
+    epoch = logIndexEpoch(year, month, day, hour, minute, second);
+    return true;
+  }
+  uint32_t n = strtoul(s, &end, 10);
+  if (end == s || *end) {
+    return false;
+  }
+  epoch = n;
+  return true;
 }
 
 String & getLogname() {
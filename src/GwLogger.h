@@ -2,8 +2,43 @@
 
 #include <Arduino.h>
 #include <sdcard.h>
+#include <N2kMsg.h>
+
+// How records are written. Set by the GWLOGFMT preference at startup.
+typedef enum {
+  LOG_JSON,     // A line of JSON for each decoded message
+  LOG_BINARY    // Every message captured as it arrived, see N2kCapture.h
+} LogFormat;
 
 void setup_logging(void);
 void append_log(const char * msg);
-void read_log(Stream & s);
-String & getLogname();
\ No newline at end of file
+void capture_log(const tN2kMsg &msg);
+LogFormat getLogFormat();
+bool logCapturesAll();
+bool loggingActive();
+String & getLogname();
+
+// Write out what is left and close the log, eg before a restart
+void close_log();
+
+// Time records per second into a growing and a preallocated file
+void benchLog(Stream &s, uint32_t records);
+
+// The bytes of a log covering a time range, found from its index
+struct LogRange {
+  uint64_t start;
+  uint64_t end;
+  uint32_t epoch;   // Time at start, for the header of a binary range
+  uint32_t ms;
+  bool binary;
+};
+
+bool findLogRange(const char *name, uint32_t from, uint32_t to, LogRange &range);
+size_t logRangeHeader(const LogRange &range, uint8_t *buf);
+bool parseLogTime(const char *s, uint32_t &epoch);
+
+// Main loop work that hands part filled blocks to the writer
+uint32_t logWork();
+
+// Print the log writer statistics
+void getLogStats(Stream &s);
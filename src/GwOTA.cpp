@@ -22,6 +22,7 @@ OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
 #include <GwOTA.h>
+#include <GwLogger.h>
 
 static Stream* Console;
 
@@ -41,6 +42,7 @@ void initializeOTA(Stream* out) {
                   else  // U_SPIFFS
                       type = "filesystem";
                   Console->println("Start updating " + type);
+                  close_log();
               })
         .onEnd([]() {
             Console->println("\nEnd");
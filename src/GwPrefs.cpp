@@ -44,6 +44,11 @@ void GwPrefsInit() {
         Reg.push_back(GWHOST);
         Reg.push_back(GWPASS);
         Reg.push_back(GWSCREEN);
+        Reg.push_back(GWPGNS);
+        Reg.push_back(GWLOG);
+        Reg.push_back(GWLOGFMT);
+        Reg.push_back(GWLOGSIZE);
+        Reg.push_back(GWLOGSPACE);
         doneInit = true;
     }
 }
@@ -64,3 +64,21 @@ void GwPrint(Stream &s);
 
 // The last selected screen number
 #define GWSCREEN "screen"
+
+// Extra PGNs to read and count as well as the ones displayed.
+// A comma separated list, or "all" to read everything.
+#define GWPGNS "pgns"
+
+// Logging to the SD card. on or off
+#define GWLOG "log"
+
+// Log format. json for a line per decoded message (the default) or bin to
+// capture every message on the bus
+#define GWLOGFMT "logfmt"
+
+// Start a new log file when the current one reaches this many MB, at
+// most 4095
+#define GWLOGSIZE "logsize"
+
+// Delete the oldest log files when they take more than this many MB
+#define GWLOGSPACE "logspace"
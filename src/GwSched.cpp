@@ -0,0 +1,154 @@
+// Main loop scheduler
+/*
+Copyright (c) 2024 Peter Martin www.naiadhome.com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <GwSched.h>
+#include <esp_timer.h>
+
+// Each work item, when it is next due and where its time goes
+typedef struct {
+    const char *name;
+    SchedWork work;
+    uint32_t due;            // millis() when it next runs
+    volatile bool ready;     // Set by schedWake to run it now
+    uint32_t runs;           // Times it has run
+    uint32_t wakes;          // Times it was woken early
+    uint64_t totalUs;        // Total time spent running it
+    uint32_t maxUs;          // Longest single run
+} SchedItem;
+
+static SchedItem items[SCHED_MAX];
+static int nitems = 0;
+
+// The task running loop(). It sleeps on its task notification.
+static TaskHandle_t loopTask = NULL;
+
+// Time spent asleep waiting for work and when the counts started
+static uint64_t sleepUs = 0;
+static int64_t startUs = 0;
+
+void schedSetup() {
+    loopTask = xTaskGetCurrentTaskHandle();
+    startUs = esp_timer_get_time();
+}
+
+void schedAdd(const char *name, SchedWork work) {
+    if (nitems >= SCHED_MAX) {
+        Serial.printf("Too many scheduled items. Can't add %s\n", name);
+        return;
+    }
+    SchedItem &item = items[nitems++];
+    item.name = name;
+    item.work = work;
+    item.due = millis();
+    item.ready = false;
+    item.runs = 0;
+    item.wakes = 0;
+    item.totalUs = 0;
+    item.maxUs = 0;
+}
+
+void schedWake(SchedWork work) {
+    for (int i = 0; i < nitems; i++) {
+        if (items[i].work == work) {
+            items[i].ready = true;
+        }
+    }
+    if (loopTask) {
+        xTaskNotifyGive(loopTask);
+    }
+}
+
+void IRAM_ATTR schedWakeFromISR(SchedWork work) {
+    BaseType_t woken = pdFALSE;
+    for (int i = 0; i < nitems; i++) {
+        if (items[i].work == work) {
+            items[i].ready = true;
+        }
+    }
+    if (loopTask) {
+        vTaskNotifyGiveFromISR(loopTask, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+}
+
+void schedRun() {
+    uint32_t now = millis();
+
+    for (int i = 0; i < nitems; i++) {
+        SchedItem &item = items[i];
+        bool due = (int32_t)(now - item.due) >= 0;
+        if (!due && !item.ready) {
+            continue;
+        }
+        if (!due) {
+            item.wakes++;
+        }
+        item.ready = false;
+
+        uint32_t start = micros();
+        uint32_t next = item.work();
+        uint32_t took = micros() - start;
+
+        item.runs++;
+        item.totalUs += took;
+        if (took > item.maxUs) {
+            item.maxUs = took;
+        }
+        now = millis();
+        item.due = now + next;
+    }
+
+    // Sleep until the earliest deadline. A wake up from another task
+    // or an interrupt ends the sleep early.
+    int32_t wait = INT32_MAX;
+    for (int i = 0; i < nitems; i++) {
+        if (items[i].ready) {
+            return;
+        }
+        int32_t left = (int32_t)(items[i].due - now);
+        if (left < wait) {
+            wait = left;
+        }
+    }
+    if (wait > 0) {
+        uint32_t start = micros();
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait));
+        sleepUs += micros() - start;
+    }
+}
+
+void schedStats(Stream &s) {
+    double elapsed = esp_timer_get_time() - startUs;
+    if (elapsed <= 0) {
+        elapsed = 1;
+    }
+    s.println("=========== SCHEDULER ==========");
+    s.printf("Work\t\tRuns\tWakes\tMean us\tMax us\tCPU%%\n");
+    for (int i = 0; i < nitems; i++) {
+        SchedItem &item = items[i];
+        uint32_t mean = item.runs ? item.totalUs / item.runs : 0;
+        s.printf("%-12s\t%u\t%u\t%u\t%u\t%.1f\n", item.name, item.runs, item.wakes,
+                 mean, item.maxUs, item.totalUs * 100.0 / elapsed);
+    }
+    s.printf("%-12s\t\t\t\t\t%.1f\n", "sleep", sleepUs * 100.0 / elapsed);
+    s.println("=========== END ==========");
+}
@@ -0,0 +1,50 @@
+// Main loop scheduler
+/*
+Copyright (c) 2024 Peter Martin www.naiadhome.com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include <Arduino.h>
+
+// Most work items that can be added
+#define SCHED_MAX 8
+
+// A piece of work run from the main loop. It returns the number of ms
+// until it next needs to run. Work that has to happen sooner, eg because
+// data has arrived, is brought forward by calling schedWake().
+typedef uint32_t (*SchedWork)(void);
+
+// Call once from setup() before adding any work.
+void schedSetup();
+
+// Add a work item. It first runs on the next pass of the loop.
+void schedAdd(const char *name, SchedWork work);
+
+// Mark a work item as ready to run now and wake the loop.
+// The ISR version is safe to call from an interrupt handler.
+void schedWake(SchedWork work);
+void IRAM_ATTR schedWakeFromISR(SchedWork work);
+
+// Run all the work that is due, then sleep until the next deadline
+// or until woken. Called from loop().
+void schedRun();
+
+// Print the time spent in each work item.
+void schedStats(Stream &s);
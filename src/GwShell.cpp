@@ -31,6 +31,10 @@ OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <SysInfo.h>
 #include <sdcard.h>
 #include <GwLogger.h>
+#include <MyWiFi.h>
+#include <GwSched.h>
+#include <VesselData.h>
+#include <tftscreen.h>
 
 #include <map>
 
@@ -63,12 +67,16 @@ int net(int argc, char** argv) {
 // Storage details
 int storage(int argc, char** argv) {
     StringStream s;
-    dir("/", 2, s);
+    {
+        SdLock lock;
+        dir("/", 2, s);
+    }
     shell.print(s.data);
     return 0;
 }
 
 int format(int argc, char ** argv) {
+    SdLock lock;
     formatSD();
     return 0;
 }
@@ -151,6 +159,7 @@ int logger(int argc, char** argv) {
 
 // reboot the ESP32 board.
 int reboot(int argc, char** argv) {
+    close_log();
     ESP.restart();
     return 0;  // I dont think we ever get here
 }
@@ -163,6 +172,63 @@ int messages(int argc, char** argv) {
     return 0;
 }
 
+// Print the counters for the YD data coming in
+int ingest(int argc, char** argv) {
+    StringStream s;
+    getIngestStats(s);
+    shell.print(s.data);
+    return 0;
+}
+
+// Show the latest vessel data values
+int data(int argc, char** argv) {
+    StringStream s;
+    getVesselData(s);
+    shell.print(s.data);
+    return 0;
+}
+
+// Show the recent display pipeline timings
+int gfx(int argc, char** argv) {
+    StringStream s;
+    getGfxStats(s);
+    shell.print(s.data);
+    return 0;
+}
+
+// Show the log writer statistics
+int logstat(int argc, char** argv) {
+    StringStream s;
+    getLogStats(s);
+    shell.print(s.data);
+    return 0;
+}
+
+// Time log writes to a growing and a preallocated file
+int logbench(int argc, char** argv) {
+    uint32_t records = argc > 1 ? atoi(argv[1]) : 20000;
+    StringStream s;
+    benchLog(s, records);
+    shell.print(s.data);
+    return 0;
+}
+
+// Show how many display updates were drawn and how many were saved
+int display(int argc, char** argv) {
+    StringStream s;
+    getDisplayStats(s);
+    shell.print(s.data);
+    return 0;
+}
+
+// Show where the main loop time goes
+int sched(int argc, char** argv) {
+    StringStream s;
+    schedStats(s);
+    shell.print(s.data);
+    return 0;
+}
+
 // remove a file
 int rmfile(int argc, char ** argv) {
     String fname;
@@ -173,6 +239,7 @@ int rmfile(int argc, char ** argv) {
         return 0;
     }
 
+    SdLock lock;
     if (!sd.remove(fname.c_str())) {
         errorPrint("Error deleteing file\n");
         return 0;
@@ -180,7 +247,8 @@ int rmfile(int argc, char ** argv) {
     return 0;
 }
 
-// cat a file to the output
+// cat a file to the output. Given times, only the part of a log between
+// them is shown, found from its index (cat FILE [FROM [TO]])
 int catlog(int argc, char ** argv) {
     String logname;
 
@@ -191,17 +259,47 @@ int catlog(int argc, char ** argv) {
         return 0;
     }
 
-    if (!file.open(logname.c_str(), O_RDWR)) {
+    LogRange range;
+    range.start = 0;
+    range.end = UINT64_MAX;
+    if (argc > 2) {
+        uint32_t from;
+        uint32_t to = UINT32_MAX;
+        if (!parseLogTime(argv[2], from) || (argc > 3 && !parseLogTime(argv[3], to))) {
+            shell.printf("Times are UTC like 2024-07-28T10:00, or back from now like -2h\n");
+            return 0;
+        }
+        if (!findLogRange(logname.c_str(), from, to, range)) {
+            errorPrint("Reading logfile\n");
+            return 0;
+        }
+        if (range.binary) {
+            shell.printf("Binary log, bytes %llu to %llu. Download it with /download?file=%s&from=%s\n",
+                         range.start, range.end, argv[1], argv[2]);
+            return 0;
+        }
+    }
+
+    sdLock();
+    bool opened = file.open(logname.c_str(), O_RDONLY) && file.seekSet(range.start);
+    sdUnlock();
+    if (!opened) {
         errorPrint("Reading logfile\n");
         return 0;
     }
 
+    // The lock is only held for each read so the log writer is not held up
     char buf[256];
     int c;
     do {
-        c = file.fgets(buf, sizeof(buf) -1);
-        shell.print(buf);
-    } while(c);
+        sdLock();
+        c = file.curPosition() < range.end ? file.fgets(buf, sizeof(buf) -1) : 0;
+        sdUnlock();
+        if (c > 0) {
+            shell.print(buf);
+        }
+    } while(c > 0);
+    SdLock lock;
     file.close();
     return 0;
 }
@@ -212,6 +310,7 @@ int df(int argc, char ** argv) {
     StringStream str;
 
     if(hasSdCard()) {
+        SdLock lock;
         shell.printf("SD Card found. Type: %s\n", getCardType());
 
         // capacity in in MB (1000000 bytes)
@@ -248,9 +347,16 @@ void initGwShell() {
     shell.addCommand(F("logger \tSet the output logging. (logger on|off)"), logger);
     shell.addCommand(F("reboot \tReboot the ESP"), reboot);
     shell.addCommand(F("msgs \t\tShow the N2K message counts"), messages);
+    shell.addCommand(F("ingest \tShow the YD ingest counters"), ingest);
+    shell.addCommand(F("data \t\tShow the vessel data values and their ages"), data);
+    shell.addCommand(F("display \tShow the display update counts"), display);
+    shell.addCommand(F("gfx \t\tShow the display render and flush timings"), gfx);
+    shell.addCommand(F("sched \tShow the main loop timings"), sched);
+    shell.addCommand(F("logstat \tShow the log writer statistics"), logstat);
+    shell.addCommand(F("logbench \tTime log writes with and without preallocation (logbench [records])"), logbench);
     shell.addCommand(F("dir \t\tList storage"), storage);
     shell.addCommand(F("Format the SD card"), format);
-    shell.addCommand(F("cat \t\tRead the logfile"), catlog);
+    shell.addCommand(F("cat \t\tRead the logfile (cat FILE [FROM [TO]])"), catlog);
     shell.addCommand(F("rm \t\tDelete a file"), rmfile);
     shell.addCommand(F("df \t\tDisplays details of the storage"), df);
 }
@@ -0,0 +1,100 @@
+// Sparse time index kept beside each log
+/*
+Copyright (c) 2024 Peter Martin www.naiadhome.com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+// Only standard headers so the index can be built by the host tools too.
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "N2kCapture.h"
+
+// Each log has an index with the same name and an .idx suffix. It lists,
+// in time order, places a reader can start from. In a text log that is the
+// start of a line. In a capture it is just after the header or a sync
+// marker, where the time of the records that follow is known.
+//
+// The logger adds an entry every LOG_INDEX_RECORDS lines of a text log, at
+// each sync marker of a capture, and at least every LOG_INDEX_MS, so even a
+// 64MB log has an index of a few thousand entries.
+//
+// Entry, LOG_INDEX_SIZE bytes, little endian
+//   epoch      4 bytes, UTC seconds, 0 if the clock was not set
+//   ms         4 bytes, millis() at that point
+//   offset     4 bytes, where it is in the log. The logger keeps each log
+//              under 4GB so this never wraps.
+#define LOG_INDEX_SUFFIX ".idx"
+#define LOG_INDEX_SIZE 12
+#define LOG_INDEX_RECORDS 500
+#define LOG_INDEX_MS 60000
+
+// Times before this are taken as the clock not having been set (2020-01-01)
+#define LOG_CLOCK_SET 1577836800
+
+struct LogIndexEntry {
+    uint32_t epoch;
+    uint32_t ms;
+    uint32_t offset;
+};
+
+static inline void logIndexPut(uint8_t *p, const LogIndexEntry &e) {
+    n2kcapPut32(p, e.epoch);
+    n2kcapPut32(p + 4, e.ms);
+    n2kcapPut32(p + 8, e.offset);
+}
+
+static inline void logIndexGet(const uint8_t *p, LogIndexEntry &e) {
+    e.epoch = n2kcapGet32(p);
+    e.ms = n2kcapGet32(p + 4);
+    e.offset = n2kcapGet32(p + 8);
+}
+
+// The index name for a log, its name with the suffix replaced
+static inline void logIndexName(char *out, size_t size, const char *log) {
+    const char *dot = strrchr(log, '.');
+    size_t len = dot ? (size_t)(dot - log) : strlen(log);
+    if (len + sizeof(LOG_INDEX_SUFFIX) > size) {
+        len = size - sizeof(LOG_INDEX_SUFFIX);
+    }
+    memcpy(out, log, len);
+    memcpy(out + len, LOG_INDEX_SUFFIX, sizeof(LOG_INDEX_SUFFIX));
+}
+
+// True if a file name is an index
+static inline bool logIsIndex(const char *name) {
+    size_t len = strlen(name);
+    size_t suffix = sizeof(LOG_INDEX_SUFFIX) - 1;
+    return len >= suffix && strcmp(name + len - suffix, LOG_INDEX_SUFFIX) == 0;
+}
+
+// UTC seconds for a date and time, without depending on the time zone
+static inline uint32_t logIndexEpoch(int year, int month, int day, int hour, int minute, int second) {
+    // Days since 1970-01-01 counting years from March, so the leap day is last
+    year -= month <= 2;
+    int era = year / 400;
+    int yoe = year - era * 400;
+    int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int32_t days = era * 146097 + doe - 719468;
+    return (uint32_t)days * 86400 + hour * 3600 + minute * 60 + second;
+}
@@ -0,0 +1,125 @@
+// Builds a JSON log record in a fixed buffer
+/*
+Copyright (c) 2024 Peter Martin www.naiadhome.com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <LogRecord.h>
+#include <NumFormat.h>
+
+// Kept free at the end of the buffer for end()
+#define LOG_RECORD_CLOSE 2
+
+void LogRecord::begin(uint32_t pgn, uint32_t ms, const char *key) {
+    len = 0;
+    nfields = 0;
+    active = true;
+    overflow = false;
+    append("{\"PGN\":");
+    appendInt(pgn);
+    append(",\"ms\":");
+    appendInt(ms);
+    append(",\"");
+    append(key);
+    append("\":{");
+}
+
+void LogRecord::add(const char *name, int32_t value) {
+    if (!active) {
+        return;
+    }
+    size_t mark = addName(name);
+    char digits[12];
+    fmtInt(digits, sizeof(digits), value);
+    append(digits);
+    endValue(mark);
+}
+
+// Add a double with a fixed number of decimal places
+void LogRecord::add(const char *name, double value, uint8_t dp) {
+    if (!active) {
+        return;
+    }
+    size_t mark = addName(name);
+    char digits[24];
+    fmtDouble(digits, sizeof(digits), value, dp);
+    append(digits);
+    endValue(mark);
+}
+
+void LogRecord::add(const char *name, const char *value) {
+    if (!active) {
+        return;
+    }
+    size_t mark = addName(name);
+    append('"');
+    append(value);
+    append('"');
+    endValue(mark);
+}
+
+// The room for the braces is always free so they are never cut off
+const char *LogRecord::end() {
+    buf[len++] = '}';
+    buf[len++] = '}';
+    buf[len] = 0;
+    return buf;
+}
+
+// Start a value with its name. Returns where it starts for endValue.
+size_t LogRecord::addName(const char *name) {
+    size_t mark = len;
+    overflow = false;
+    if (nfields++) {
+        append(',');
+    }
+    append('"');
+    append(name);
+    append("\":");
+    return mark;
+}
+
+// Take the value out again if it did not all fit
+void LogRecord::endValue(size_t mark) {
+    if (overflow) {
+        len = mark;
+        nfields--;
+        overflow = false;
+    }
+}
+
+void LogRecord::append(const char *str) {
+    while (*str) {
+        append(*str++);
+    }
+}
+
+void LogRecord::append(char c) {
+    if (len < LOG_RECORD_SIZE - 1 - LOG_RECORD_CLOSE) {
+        buf[len++] = c;
+    } else {
+        overflow = true;
+    }
+}
+
+void LogRecord::appendInt(uint32_t value) {
+    char digits[12];
+    fmtUint(digits, sizeof(digits), value);
+    append(digits);
+}
@@ -0,0 +1,70 @@
+// Builds a JSON log record in a fixed buffer
+/*
+Copyright (c) 2024 Peter Martin www.naiadhome.com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include <Arduino.h>
+
+// Longest record that can be built. A value that would not fit is left out
+// whole, and room is always kept for the closing braces, so the record is
+// still valid JSON.
+#define LOG_RECORD_SIZE 256
+
+// Builds one log line of the form
+//   {"PGN":127508,"ms":123456,"2024-7-28 10:17:38":{"housev":12.81,"housei":-2.5}}
+// straight into a buffer that is reused for every message, so logging
+// a message never touches the heap. If the record was not started because
+// logging is off, adding values does nothing.
+class LogRecord {
+   public:
+    // Start a record for a message. key is the time stamp for the values.
+    void begin(uint32_t pgn, uint32_t ms, const char *key);
+
+    // Leave the record unstarted so values added are ignored
+    void disable() {
+        active = false;
+        nfields = 0;
+        len = 0;
+    }
+
+    void add(const char *name, int32_t value);
+    void add(const char *name, double value, uint8_t dp);
+    void add(const char *name, const char *value);
+
+    // Number of values added
+    uint8_t fields() const { return nfields; }
+
+    // Close the record and return the text
+    const char *end();
+
+   private:
+    size_t addName(const char *name);
+    void endValue(size_t mark);
+    void append(const char *str);
+    void append(char c);
+    void appendInt(uint32_t value);
+
+    char buf[LOG_RECORD_SIZE];
+    size_t len = 0;
+    uint8_t nfields = 0;
+    bool active = false;
+    bool overflow = false;  // Something did not fit since the last value started
+};
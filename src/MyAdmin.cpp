@@ -66,7 +66,10 @@ void adminSetup(void) {
     setShellSource(&Serial);
 }
 
-void adminWork() {
+// How often to poll the shell, telnet and OTA
+#define ADMIN_PERIOD 20
+
+uint32_t adminWork() {
     if (WiFi.status() == WL_CONNECTED) {
         // handle any telnet sessions
         handleTelnet();
@@ -75,4 +78,5 @@ void adminWork() {
 
     // run any local shell commands
     handleShell();
+    return ADMIN_PERIOD;
 }
@@ -25,4 +25,4 @@ OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 extern String host_name;
 
 void adminSetup();
-void adminWork();
\ No newline at end of file
+uint32_t adminWork();
\ No newline at end of file
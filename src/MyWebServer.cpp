@@ -11,6 +11,9 @@
 #include <sdcard.h>
 #include <SdFat.h>
 #include <SysInfo.h>
+#include <VesselData.h>
+#include <GwLogger.h>
+#include <N2kCapture.h>
 
 // HTML strings
 #include <html/style.html>  // Must come before the content files
@@ -57,7 +60,10 @@ public:
         const int bsize = 4096;
         char buf[bsize];
         Serial.printf("In handler for %s\n", requestUri.c_str());
-        if(!file.open(requestUri.c_str(), O_RDONLY)) {
+        sdLock();
+        bool opened = file.open(requestUri.c_str(), O_RDONLY);
+        sdUnlock();
+        if(!opened) {
             server.send(404, "text/html", "No such file");
             return false;
         } else {
@@ -69,10 +75,13 @@ public:
             uint32_t count =0;
             int c;
             do {
+                sdLock();
                 c = file.readBytes(buf, bsize);  
+                sdUnlock();
                 server.sendContent(buf, c); 
                 count += c;
             } while (c);
+            SdLock lock;
             file.close();
 
          //   server.send(200);
@@ -119,6 +128,7 @@ void webServerSetup(void) {
             Serial.printf("Body: %s\n", body.c_str());
             Serial.printf("Filename %s\n", filename.c_str());
             server.send(200, "text/plain", "");
+            SdLock lock;
             file.open(filename.c_str(), O_CREAT | O_WRITE | O_TRUNC);
             file.write(body.c_str(), body.length());
             file.close();
@@ -137,10 +147,12 @@ void webServerSetup(void) {
             });
 
         server.on("/system", HTTP_GET, []() {
-            StringStream net, sys, msgs;
+            StringStream net, sys, msgs, data, gfx;
             getNetInfo(net);
             getSysInfo(sys);
             getN2kMsgs(msgs);
+            getVesselData(data);
+            getGfxStats(gfx);
             server.sendHeader("Connection", "close");
             server.send(200, "text/html", style + 
                     head_html + 
@@ -149,15 +161,21 @@ void webServerSetup(void) {
                     net.data + 
                     sys.data + 
                     msgs.data + 
+                    data.data + 
+                    gfx.data + 
                     "</pre>" + 
                     nav +
                     footer_html);
             });
 
-        // Handle downloading a logfile
+        // Handle downloading a logfile. from and to pick out a time range
+        // using the log's index, eg /download?file=NAME&from=-2h
         server.on("/download", HTTP_GET, []() {
             // Default logfile is the current one
-            String logname("logfile.txt");
+            String logname(getLogname());
+            uint32_t from = 0;
+            uint32_t to = UINT32_MAX;
+            bool ranged = false;
 
             int nargs = server.args();
             Serial.printf("There are %d args\n", nargs);
@@ -168,9 +186,27 @@ void webServerSetup(void) {
                 if(argname == "file") {
                     logname = arg;
                 }
+                if(argname == "from") {
+                    ranged |= parseLogTime(arg.c_str(), from);
+                }
+                if(argname == "to") {
+                    ranged |= parseLogTime(arg.c_str(), to);
+                }
+            }
+
+            LogRange range;
+            range.start = 0;
+            range.end = UINT64_MAX;
+            range.binary = false;
+            if (ranged) {
+                findLogRange(logname.c_str(), from, to, range);
             }
 
-            if (!file.open(logname.c_str(), O_RDWR)) {
+            // The lock is only held for each read so the log writer is not held up
+            sdLock();
+            bool opened = file.open(logname.c_str(), O_RDONLY) && file.seekSet(range.start);
+            sdUnlock();
+            if (!opened) {
                 errorPrint("Reading logfile\n");
                 server.send(404, "application/octet-stream", "No such file");
             }
@@ -188,14 +224,26 @@ void webServerSetup(void) {
                 else {
                     server.setContentLength(CONTENT_LENGTH_UNKNOWN);
                     server.sendHeader("Content-Type", "application/octet-stream");
-                    server.sendHeader("Content-Disposition", "attachment; filename=logfile.txt");
+                    server.sendHeader("Content-Disposition", "attachment; filename=" + logname);
                     server.send(200, "application/octet-stream", "");
-                    
+
+                    // A capture cut from the middle gets a header of its own
+                    uint8_t header[N2KCAP_HEADER_SIZE];
+                    size_t hlen = logRangeHeader(range, header);
+                    if (hlen) {
+                        server.sendContent((const char*)header, hlen);
+                    }
+
                     ulong start = micros();
                     uint32_t count =0;
+                    uint64_t pos = range.start;
                     int c;
                     do {
-                        c = file.readBytes(buf, bsize);  
+                        size_t want = range.end - pos < bsize ? range.end - pos : bsize;
+                        sdLock();
+                        c = want ? file.readBytes(buf, want) : 0;
+                        sdUnlock();
+                        pos += c;
                         //memset(buf,'$', bsize); if(count > 819200) {c = 0;} else {c = bsize;}
                         server.sendContent(buf, c); 
                         count += c;
@@ -203,7 +251,9 @@ void webServerSetup(void) {
                     ulong now = micros();
                     Serial.printf("Read %d bytes in %d usecs = %.2f kbytes/sec\n", 
                         count, now - start, (float)count / ((now - start) / 1000.0));
+                    sdLock();
                     file.close();
+                    sdUnlock();
                     free(buf);
                 }
             }
@@ -216,8 +266,12 @@ void webServerSetup(void) {
     }
 }
 
-void webServerWork() {
+// How often to poll for web requests
+#define WEB_PERIOD 10
+
+uint32_t webServerWork() {
     if (WiFi.status() == WL_CONNECTED) {
         server.handleClient();
     }
+    return WEB_PERIOD;
 }
\ No newline at end of file
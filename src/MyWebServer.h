@@ -2,4 +2,4 @@
 void webServerSetup(void);
 
 // Do some work with the web server
-void webServerWork();
+uint32_t webServerWork();
@@ -28,8 +28,12 @@ OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <MyWiFi.h>
 #include <StringStream.h>
 #include <YDtoN2KUDP.h>
+#include <N2kFastPacket.h>
+#include <SpscRing.h>
+#include <GwSched.h>
 #include <handlePGN.h>
 #include <tftscreen.h>
+#include <GwLogger.h>
 
 #include <map>
 
@@ -63,6 +67,20 @@ String WifiIP = "Unknown";
 // The UDP yacht data reader
 YDtoN2kUDP ydtoN2kUDP;
 
+// Puts the fast packet frames from the YD reader back together
+N2kFastPacket fastPacket;
+
+// The YD data is read and decoded by its own task so frames are taken from
+// the network promptly whatever the main loop is doing. The decoded messages
+// are passed to the main loop through this ring.
+#define INGEST_QUEUE_SIZE 32    // Must be a power of 2
+#define INGEST_CORE 0           // The Arduino loop runs on core 1
+#define INGEST_PRIORITY 2       // Above the loop task
+#define INGEST_STACK 4096
+#define INGEST_POLL_MS 2        // How long to sleep when the socket is empty
+
+static SpscRing<tN2kMsg, INGEST_QUEUE_SIZE> ingestQueue;
+
 // The wifi UDP socket
 WiFiUDP wifiUdp;
 
@@ -136,7 +154,13 @@ void disconnectWifi() {
     WifiMode = "Not connected";
 }
 
-void wifiCheck() {
+// How often to check the connection
+#define WIFI_CHECK_PERIOD 1000
+
+// How long wifiWork sleeps if it is not woken by the ingest task
+#define WIFI_WORK_PERIOD 100
+
+uint32_t wifiCheck() {
     uint32_t wifi_retry = 0;
 
     if (hadconnection) {
@@ -147,6 +171,61 @@ void wifiCheck() {
             connectWifi();
         }
     }
+    return WIFI_CHECK_PERIOD;
+}
+
+// Build the set of PGNs the ingest task decodes. These are the ones
+// the registry has decoders for plus any extra ones set in the preferences,
+// or all of them when a binary log is capturing the whole bus.
+static void setupFilter() {
+    PgnFilter& filter = ydtoN2kUDP.filter;
+    const PgnHandler* handlers;
+    size_t n = getPgnHandlers(&handlers);
+    for (size_t i = 0; i < n; i++) {
+        if (handlers[i].decode) {
+            filter.add(handlers[i].pgn);
+        }
+    }
+
+    String extra = GwGetVal(GWPGNS, "");
+    if (extra == "all" || logCapturesAll()) {
+        filter.allowAll(true);
+        return;
+    }
+    const char* p = extra.c_str();
+    while (*p) {
+        char* next;
+        uint32_t pgn = strtoul(p, &next, 10);
+        if (next == p) {
+            p++;  // Skip separators
+        } else {
+            filter.add(pgn);
+            p = next;
+        }
+    }
+}
+
+// Task to read the YD data, put the fast packets back together
+// and queue the messages for the main loop.
+static void ingestTask(void* param) {
+    tN2kMsg frame;
+
+    while (true) {
+        if (WiFi.status() == WL_CONNECTED) {
+            bool queued = false;
+            while (ydtoN2kUDP.readYD(frame)) {
+                tN2kMsg* msg = fastPacket.add(frame, millis());
+                if (msg && ingestQueue.push(*msg)) {
+                    queued = true;
+                }
+            }
+            // Let the main loop know there is work waiting
+            if (queued) {
+                schedWake(wifiWork);
+            }
+        }
+        vTaskDelay(pdMS_TO_TICKS(INGEST_POLL_MS));
+    }
 }
 
 // WiFi setup.
@@ -197,23 +276,41 @@ void wifiSetup(String& host_name) {
         // Start the telnet server
         telnet.begin();
 
-        // start the YD UDP socket
+        // start the YD UDP socket and the task that reads it
+        setupFilter();
         ydtoN2kUDP.begin(4444);
+        xTaskCreatePinnedToCore(ingestTask, "ingest", INGEST_STACK, NULL,
+                                INGEST_PRIORITY, NULL, INGEST_CORE);
 
         // Start the OTA service
         initializeOTA(Console);
     }
 }
 
-// Read the YD data, decode the N2K messages
+// Handle the N2K messages queued by the ingest task
 // and update the screen copies.
-void wifiWork(void) {
-    tN2kMsg msg;
-
-    if (WiFi.status() == WL_CONNECTED) {
-        while (ydtoN2kUDP.readYD(msg)) {
-            N2kMsgMap[msg.PGN]++;
-            handlePGN(msg);
-        }
+// Runs when woken by the ingest task. Takes at most a ring full at a time
+// so the rest of the loop still gets a look in during a burst.
+uint32_t wifiWork(void) {
+    tN2kMsg* msg;
+    size_t count = 0;
+
+    while (count < ingestQueue.capacity() && (msg = ingestQueue.front())) {
+        N2kMsgMap[msg->PGN]++;
+        handlePGN(*msg);
+        ingestQueue.pop();
+        count++;
     }
+    return ingestQueue.size() ? 0 : WIFI_WORK_PERIOD;
+}
+
+// Print the YD ingest counters to the stream
+void getIngestStats(Stream& s) {
+    s.println("=========== INGEST ==========");
+    ydtoN2kUDP.printStats(s);
+    fastPacket.printStats(s);
+    s.printf("Queue waiting\t%u/%u\n", (unsigned)ingestQueue.size(), (unsigned)ingestQueue.capacity());
+    s.printf("Queue high water\t%u\n", ingestQueue.highWater.load());
+    s.printf("Queue overflows\t%u\n", ingestQueue.overflows.load());
+    s.println("=========== END ==========");
 }
@@ -42,8 +42,10 @@ extern Stream* Console;
 void wifiSetup(String& host_name);
 
 // Check its still connected and re-connect if not
-void wifiCheck(void);
+uint32_t wifiCheck(void);
 
 // Do some work with the network
-void wifiWork(void);
+uint32_t wifiWork(void);
 
+// Print the YD ingest counters
+void getIngestStats(Stream& s);
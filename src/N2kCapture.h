@@ -0,0 +1,213 @@
+// Compact binary capture format for N2K messages
+/*
+Copyright (c) 2024 Peter Martin www.naiadhome.com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+// Only standard headers so the format can be read by the host tools too.
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// A capture file is a header followed by frame records, with a sync marker
+// after every N2KCAP_SYNC_BYTES or so. All numbers are little endian.
+//
+// Header, N2KCAP_HEADER_SIZE bytes
+//   "N2KCAP"   magic
+//   version    1 byte
+//   flags      1 byte, 0
+//   epoch      4 bytes, UTC seconds when the capture started, 0 if not known
+//   ms         4 bytes, millis() when the capture started
+//
+// Frame record
+//   len        1 byte, payload length 0..223
+//   delta      LEB128 varint, ms since the previous record (or the header)
+//   canId      4 bytes, the 29 bit CAN id with priority, PGN and addresses
+//   payload    len bytes, a whole message with fast packets reassembled
+//
+// Sync marker, N2KCAP_SYNC_SIZE bytes
+//   0xFF "N2KS"
+//   records    4 bytes, frames written since the header
+//   ms         4 bytes, millis() of the last frame
+//   epoch      4 bytes, UTC seconds at that frame, 0 if not known
+//   crc        4 bytes, CRC-32 of every byte after the previous sync marker,
+//              or the header, up to the start of this one
+//
+// A length byte can never be 0xFF, so after damage a reader can scan for the
+// next "\xFFN2KS", check its CRC, and carry on from there with the time it holds.
+
+#define N2KCAP_MAGIC "N2KCAP"
+#define N2KCAP_VERSION 1
+#define N2KCAP_HEADER_SIZE 16
+#define N2KCAP_SYNC 0xFF
+#define N2KCAP_SYNC_MAGIC "N2KS"
+#define N2KCAP_SYNC_SIZE 21
+#define N2KCAP_MAX_DATA 223
+#define N2KCAP_MAX_RECORD (1 + 5 + 4 + N2KCAP_MAX_DATA)
+#define N2KCAP_SYNC_BYTES 4096
+
+// Room for the largest frame and the sync marker that may follow it
+#define N2KCAP_MAX_OUT (N2KCAP_MAX_RECORD + N2KCAP_SYNC_SIZE)
+
+static inline void n2kcapPut32(uint8_t *p, uint32_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static inline uint32_t n2kcapGet32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// CRC-32 as used by zip, a nibble at a time to keep the table small
+static inline uint32_t n2kcapCrc32(uint32_t crc, const uint8_t *p, size_t len) {
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+    };
+    crc = ~crc;
+    while (len--) {
+        crc ^= *p++;
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+// Pack the N2K header fields into a 29 bit CAN id. PDU1 PGNs, those with a
+// PF byte below 240, carry the destination in their low byte.
+static inline uint32_t n2kcapCanId(uint8_t priority, uint32_t pgn, uint8_t source, uint8_t destination) {
+    uint32_t id = ((uint32_t)(priority & 0x07) << 26) | (source & 0xFF);
+    if (((pgn >> 8) & 0xFF) < 240) {
+        id |= ((pgn & 0x3FF00) << 8) | ((uint32_t)destination << 8);
+    } else {
+        id |= (pgn & 0x3FFFF) << 8;
+    }
+    return id;
+}
+
+// Unpack a CAN id. PDU2 messages are broadcasts so get destination 0xFF.
+static inline void n2kcapSplitId(uint32_t id, uint8_t &priority, uint32_t &pgn, uint8_t &source, uint8_t &destination) {
+    priority = (id >> 26) & 0x07;
+    source = id & 0xFF;
+    uint8_t pf = (id >> 16) & 0xFF;
+    if (pf < 240) {
+        destination = (id >> 8) & 0xFF;
+        pgn = (id >> 8) & 0x3FF00;
+    } else {
+        destination = 0xFF;
+        pgn = (id >> 8) & 0x3FFFF;
+    }
+}
+
+// The size of the frame record at p, which must not be a sync marker, with
+// its time delta. Returns 0 if the record runs past the avail bytes or its
+// delta is too long to be valid.
+static inline size_t n2kcapRecord(const uint8_t *p, size_t avail, uint32_t &delta) {
+    size_t n = 1;
+    int shift = 0;
+    delta = 0;
+    do {
+        if (n >= avail || shift > 28) {
+            return 0;
+        }
+        delta |= (uint32_t)(p[n] & 0x7F) << shift;
+        shift += 7;
+    } while (p[n++] & 0x80);
+    n += 4 + p[0];
+    return n <= avail ? n : 0;
+}
+
+// Builds a capture stream. Each call writes into out, which must have room
+// for N2KCAP_MAX_OUT bytes, and returns the number of bytes written.
+class N2kCapEncoder {
+   public:
+    // Start a new capture
+    size_t header(uint8_t *out, uint32_t epoch, uint32_t ms) {
+        memcpy(out, N2KCAP_MAGIC, 6);
+        out[6] = N2KCAP_VERSION;
+        out[7] = 0;
+        n2kcapPut32(out + 8, epoch);
+        n2kcapPut32(out + 12, ms);
+        lastMs = ms;
+        lastEpoch = epoch;
+        crc = 0;
+        sinceSync = 0;
+        records = 0;
+        return N2KCAP_HEADER_SIZE;
+    }
+
+    // Add a frame, followed by a sync marker if one is due. epoch is the
+    // UTC time now, or 0 if not known. Longer payloads are cut to 223 bytes.
+    size_t frame(uint8_t *out, uint32_t ms, uint32_t epoch, uint32_t canId, const uint8_t *data, size_t len) {
+        if (len > N2KCAP_MAX_DATA) {
+            len = N2KCAP_MAX_DATA;
+        }
+        uint8_t *p = out;
+        *p++ = len;
+        uint32_t delta = ms - lastMs;
+        do {
+            uint8_t b = delta & 0x7F;
+            delta >>= 7;
+            *p++ = delta ? (b | 0x80) : b;
+        } while (delta);
+        n2kcapPut32(p, canId);
+        p += 4;
+        memcpy(p, data, len);
+        p += len;
+
+        size_t n = p - out;
+        crc = n2kcapCrc32(crc, out, n);
+        sinceSync += n;
+        records++;
+        lastMs = ms;
+        lastEpoch = epoch;
+        if (sinceSync >= N2KCAP_SYNC_BYTES) {
+            n += sync(p);
+        }
+        return n;
+    }
+
+    // Write a sync marker now, eg before the capture is closed
+    size_t sync(uint8_t *out) {
+        out[0] = N2KCAP_SYNC;
+        memcpy(out + 1, N2KCAP_SYNC_MAGIC, 4);
+        n2kcapPut32(out + 5, records);
+        n2kcapPut32(out + 9, lastMs);
+        n2kcapPut32(out + 13, lastEpoch);
+        n2kcapPut32(out + 17, crc);
+        crc = 0;
+        sinceSync = 0;
+        return N2KCAP_SYNC_SIZE;
+    }
+
+    uint32_t frames() const { return records; }
+
+    // Bytes written since the header or the last sync marker
+    uint32_t pending() const { return sinceSync; }
+
+   private:
+    uint32_t lastMs = 0;
+    uint32_t lastEpoch = 0;
+    uint32_t crc = 0;
+    uint32_t sinceSync = 0;
+    uint32_t records = 0;
+};
@@ -0,0 +1,208 @@
+// Reassembly of NMEA 2000 fast packet messages from single CAN frames
+/*
+Copyright (c) 2024 Peter Martin www.naiadhome.com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <N2kFastPacket.h>
+
+// The standard PGNs that are sent as fast packets. Must be kept sorted.
+static const uint32_t fastPacketPGNs[] = {
+    126208, 126464, 126720, 126983, 126984, 126985, 126986, 126987, 126988,
+    126996, 126998, 127233, 127237, 127489, 127496, 127497, 127498, 127503,
+    127504, 127506, 127507, 127509, 127510, 127511, 127512, 127513, 127514,
+    128275, 128520, 129029, 129038, 129039, 129040, 129041, 129044, 129045,
+    129284, 129285, 129301, 129302, 129538, 129540, 129541, 129542, 129545,
+    129547, 129549, 129551, 129556, 129792, 129793, 129794, 129795, 129796,
+    129797, 129798, 129799, 129800, 129801, 129802, 129803, 129804, 129805,
+    129806, 129807, 129808, 129809, 129810, 130052, 130053, 130054, 130060,
+    130061, 130064, 130065, 130066, 130067, 130068, 130069, 130070, 130071,
+    130072, 130073, 130074, 130320, 130321, 130322, 130323, 130324, 130567,
+    130569, 130570, 130571, 130572, 130573, 130574, 130577, 130578, 130580,
+    130581, 130582, 130583, 130584, 130585, 130586,
+};
+
+// Proprietary fast packet range
+#define FP_PROP_FIRST 130816
+#define FP_PROP_LAST 131071
+
+N2kFastPacket::N2kFastPacket() {
+    for (int i = 0; i < FP_SLOTS; i++) {
+        slots[i].used = false;
+    }
+}
+
+bool N2kFastPacket::isFastPacket(uint32_t pgn) {
+    if (pgn >= FP_PROP_FIRST && pgn <= FP_PROP_LAST) {
+        return true;
+    }
+
+    // Binary search the table
+    int lo = 0;
+    int hi = sizeof(fastPacketPGNs) / sizeof(fastPacketPGNs[0]) - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (fastPacketPGNs[mid] == pgn) {
+            return true;
+        } else if (fastPacketPGNs[mid] < pgn) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return false;
+}
+
+// Find the slot collecting this sequence. Slots that have timed out
+// are released on the way.
+N2kFastPacket::Slot *N2kFastPacket::find(const tN2kMsg &frame, uint8_t seq, uint32_t now) {
+    Slot *found = NULL;
+    for (int i = 0; i < FP_SLOTS; i++) {
+        Slot &slot = slots[i];
+        if (!slot.used) {
+            continue;
+        }
+        if (now - slot.start > FP_TIMEOUT) {
+            slot.used = false;
+            dropped++;
+            continue;
+        }
+        if (slot.msg.Source == frame.Source && slot.msg.PGN == frame.PGN && slot.seq == seq) {
+            found = &slot;
+        }
+    }
+    return found;
+}
+
+// Get a free slot. If they are all in use the oldest sequence is dropped.
+N2kFastPacket::Slot *N2kFastPacket::allocate(uint32_t now) {
+    Slot *oldest = &slots[0];
+    for (int i = 0; i < FP_SLOTS; i++) {
+        if (!slots[i].used) {
+            return &slots[i];
+        }
+        if (now - slots[i].start > now - oldest->start) {
+            oldest = &slots[i];
+        }
+    }
+    oldest->used = false;
+    dropped++;
+    return oldest;
+}
+
+tN2kMsg *N2kFastPacket::add(tN2kMsg &frame, uint32_t now) {
+    if (!isFastPacket(frame.PGN)) {
+        return &frame;
+    }
+    if (frame.DataLen < 2) {
+        outOfOrder++;
+        return NULL;
+    }
+
+    uint8_t seq = (frame.Data[0] >> 5) & 0x7;
+    uint8_t counter = frame.Data[0] & 0x1f;
+    Slot *slot = find(frame, seq, now);
+
+    if (counter == 0) {
+        // First frame. A sequence already open with the same key never finished.
+        if (slot) {
+            slot->used = false;
+            dropped++;
+        }
+        uint8_t len = frame.Data[1];
+        if (len > tN2kMsg::MaxDataLen || (frame.DataLen < 8 && frame.DataLen - 2 < len)) {
+            outOfOrder++;
+            return NULL;
+        }
+        slot = allocate(now);
+        slot->used = true;
+        slot->seq = seq;
+        slot->nextFrame = 1;
+        slot->received = 0;
+        slot->start = now;
+        slot->msg.Source = frame.Source;
+        slot->msg.Priority = frame.Priority;
+        slot->msg.Destination = frame.Destination;
+        slot->msg.SetPGN(frame.PGN);
+        slot->msg.DataLen = len;
+
+        uint8_t n = frame.DataLen - 2;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(slot->msg.Data, &frame.Data[2], n);
+        slot->received = n;
+        if (n < len) {
+            return NULL;
+        }
+    } else {
+        if (!slot) {
+            // The start of this sequence was missed
+            outOfOrder++;
+            return NULL;
+        }
+        if (counter != slot->nextFrame) {
+            // A frame went missing so the message can't be completed
+            outOfOrder++;
+            dropped++;
+            slot->used = false;
+            return NULL;
+        }
+        slot->nextFrame++;
+
+        int offset = slot->received;
+        int n = frame.DataLen - 1;
+        if (offset + n > slot->msg.DataLen) {
+            n = slot->msg.DataLen - offset;
+        }
+        if (n < 0) {
+            n = 0;
+        }
+        if (offset + n < slot->msg.DataLen && frame.DataLen < 8) {
+            // Short but not the last frame
+            outOfOrder++;
+            dropped++;
+            slot->used = false;
+            return NULL;
+        }
+        memcpy(&slot->msg.Data[offset], &frame.Data[1], n);
+        slot->received += n;
+        if (slot->received < slot->msg.DataLen) {
+            return NULL;
+        }
+    }
+
+    // All the frames are in
+    slot->used = false;
+    completed++;
+    return &slot->msg;
+}
+
+void N2kFastPacket::printStats(Stream &s) {
+    int busy = 0;
+    for (int i = 0; i < FP_SLOTS; i++) {
+        if (slots[i].used) {
+            busy++;
+        }
+    }
+    s.printf("FP completed\t%u\n", completed);
+    s.printf("FP dropped\t%u\n", dropped);
+    s.printf("FP out of order\t%u\n", outOfOrder);
+    s.printf("FP slots busy\t%d/%d\n", busy, FP_SLOTS);
+}
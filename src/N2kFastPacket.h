@@ -0,0 +1,75 @@
+// Reassembly of NMEA 2000 fast packet messages from single CAN frames
+/*
+Copyright (c) 2024 Peter Martin www.naiadhome.com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include <Arduino.h>
+#include <N2kMsg.h>
+
+// Number of fast packet sequences that can be in progress at once
+#define FP_SLOTS 8
+
+// A sequence not completed in this many ms is abandoned
+#define FP_TIMEOUT 750
+
+// Fast packet messages arrive as a run of 8 byte CAN frames. The first
+// byte of each frame holds a 3 bit sequence number and a 5 bit frame counter.
+// Frame 0 then has the total length and 6 bytes of data, the rest have 7.
+// Only the last frame may be short. A sequence with a short frame before
+// its end is dropped, as its bytes can't be put in the right place.
+// Frames from different senders and sequences can be interleaved, so each
+// sequence in progress gets a slot from a fixed pool keyed by source, PGN
+// and sequence number. Nothing is allocated when frames are added.
+class N2kFastPacket {
+   public:
+    N2kFastPacket();
+
+    // True if the PGN is sent as a fast packet
+    static bool isFastPacket(uint32_t pgn);
+
+    // Feed in a frame. Returns the message to handle: the frame itself for
+    // single frame PGNs, the whole message when the last frame of a fast
+    // packet arrives, or NULL while a sequence is still being collected.
+    // A returned message is only valid until the next call.
+    tN2kMsg *add(tN2kMsg &frame, uint32_t now);
+
+    // Print the counters
+    void printStats(Stream &s);
+
+    uint32_t completed = 0;   // Messages reassembled
+    uint32_t dropped = 0;     // Sequences abandoned before they completed
+    uint32_t outOfOrder = 0;  // Frames that did not follow on in their sequence
+
+   private:
+    struct Slot {
+        bool used;
+        uint8_t seq;        // Sequence number from the first frame
+        uint8_t nextFrame;  // The frame counter expected next
+        uint8_t received;   // Data bytes collected so far
+        uint32_t start;     // When the first frame arrived
+        tN2kMsg msg;        // The message being built
+    };
+
+    Slot *find(const tN2kMsg &frame, uint8_t seq, uint32_t now);
+    Slot *allocate(uint32_t now);
+
+    Slot slots[FP_SLOTS];
+};
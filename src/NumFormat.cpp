@@ -0,0 +1,112 @@
+// Formats numbers into caller buffers without String or printf
+/*
+Copyright (c) 2024 Peter Martin www.naiadhome.com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <NumFormat.h>
+
+static const uint32_t pow10[NUMF_MAX_DP + 1] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000};
+
+// Copy str to buf at len, stopping when buf is full. Returns the new length.
+static size_t put(char *buf, size_t size, size_t len, const char *str) {
+    while (*str && len + 1 < size) {
+        buf[len++] = *str++;
+    }
+    if (size) {
+        buf[len] = 0;
+    }
+    return len;
+}
+
+size_t fmtUint(char *buf, size_t size, uint32_t value) {
+    return fmtFixed(buf, size, value, 0);
+}
+
+size_t fmtInt(char *buf, size_t size, int32_t value) {
+    return fmtFixed(buf, size, value, 0);
+}
+
+size_t fmtFixed(char *buf, size_t size, int64_t scaled, uint8_t dp) {
+    if (dp > NUMF_MAX_DP) {
+        dp = NUMF_MAX_DP;
+    }
+    bool negative = scaled < 0;
+    uint64_t mag = negative ? -(uint64_t)scaled : (uint64_t)scaled;
+    uint64_t whole = mag / pow10[dp];
+    uint32_t frac = mag - whole * pow10[dp];
+
+    // Build the text backwards from the last digit
+    char digits[24];
+    char *p = digits + sizeof(digits);
+    *--p = 0;
+    for (int i = 0; i < dp; i++) {
+        *--p = '0' + frac % 10;
+        frac /= 10;
+    }
+    if (dp) {
+        *--p = '.';
+    }
+    // Only values of 2^32 and more need the slower 64 bit division
+    while (whole > UINT32_MAX) {
+        *--p = '0' + whole % 10;
+        whole /= 10;
+    }
+    uint32_t w = whole;
+    do {
+        *--p = '0' + w % 10;
+        w /= 10;
+    } while (w);
+    if (negative) {
+        *--p = '-';
+    }
+    return put(buf, size, 0, p);
+}
+
+size_t fmtDouble(char *buf, size_t size, double value, uint8_t dp) {
+    if (dp > NUMF_MAX_DP) {
+        dp = NUMF_MAX_DP;
+    }
+    if (isnan(value) || value > INT64_MAX / 100000000.0 || value < INT64_MIN / 100000000.0) {
+        return put(buf, size, 0, "null");
+    }
+    int64_t scaled = (int64_t)(value * pow10[dp] + (value < 0 ? -0.5 : 0.5));
+    return fmtFixed(buf, size, scaled, dp);
+}
+
+size_t fmtValue(char *buf, size_t size, float value, uint8_t dp, uint8_t width, const char *units) {
+    if (dp > NUMF_MAX_DP) {
+        dp = NUMF_MAX_DP;
+    }
+    char number[24];
+    size_t n;
+    if (isnan(value) || value > 2e9f || value < -2e9f) {
+        n = put(number, sizeof(number), 0, "---");
+    } else {
+        // Single precision is enough for display and uses the FPU
+        int64_t scaled = (int64_t)(value * pow10[dp] + (value < 0 ? -0.5f : 0.5f));
+        n = fmtFixed(number, sizeof(number), scaled, dp);
+    }
+    size_t len = 0;
+    for (size_t pad = n; pad < width && len + 1 < size; pad++) {
+        buf[len++] = ' ';
+    }
+    len = put(buf, size, len, number);
+    return put(buf, size, len, units);
+}
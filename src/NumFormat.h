@@ -0,0 +1,48 @@
+// Formats numbers into caller buffers without String or printf
+/*
+Copyright (c) 2024 Peter Martin www.naiadhome.com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include <Arduino.h>
+
+// Most decimal places that can be asked for
+#define NUMF_MAX_DP 7
+
+// These write a nul terminated string into buf, truncated if it does not
+// fit in size bytes, and return the number of characters written. They
+// use integer arithmetic only, so there is no soft-float formatting and
+// no heap allocation.
+
+size_t fmtUint(char *buf, size_t size, uint32_t value);
+size_t fmtInt(char *buf, size_t size, int32_t value);
+
+// Format a fixed point value that has been scaled by 10^dp,
+// eg fmtFixed(buf, size, -1281, 2) gives "-12.81"
+size_t fmtFixed(char *buf, size_t size, int64_t scaled, uint8_t dp);
+
+// Round a value to dp decimal places and format it
+size_t fmtDouble(char *buf, size_t size, double value, uint8_t dp);
+
+// Format a value for display. The number is right aligned in width
+// characters so the text does not jump about as the number of digits
+// changes, and the units follow it. eg fmtValue(buf, size, 9.5, 1, 5, "kts")
+// gives "  9.5kts".
+size_t fmtValue(char *buf, size_t size, float value, uint8_t dp, uint8_t width, const char *units);
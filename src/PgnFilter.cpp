@@ -0,0 +1,73 @@
+// Set of the PGNs we want to decode
+/*
+Copyright (c) 2024 Peter Martin www.naiadhome.com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <PgnFilter.h>
+
+PgnFilter::PgnFilter() {
+    memset(bits, 0, sizeof(bits));
+}
+
+void PgnFilter::add(uint32_t pgn) {
+    all = false;
+    uint32_t bit = pgn - PGNF_BASE;
+    if (bit < PGNF_RANGE) {
+        bits[bit >> 3] |= 1 << (bit & 7);
+    } else if (!wants(pgn)) {
+        if (nextra < PGNF_EXTRA) {
+            extra[nextra++] = pgn;
+        } else {
+            Serial.printf("Too many PGNs outside the filter range. Can't add %u\n", pgn);
+        }
+    }
+}
+
+void PgnFilter::allowAll(bool a) {
+    all = a;
+}
+
+// Count a skipped frame. Only called from the task reading the data.
+void PgnFilter::skipped(uint32_t pgn) {
+    skippedTotal++;
+    for (int i = 0; i < ncounts; i++) {
+        if (counts[i].pgn == pgn) {
+            counts[i].count++;
+            return;
+        }
+    }
+    if (ncounts < PGNF_COUNTED) {
+        counts[ncounts].pgn = pgn;
+        counts[ncounts].count = 1;
+        ncounts++;
+    } else {
+        skippedOther++;
+    }
+}
+
+void PgnFilter::printSkipped(Stream &s, const char *(*name)(uint32_t)) {
+    int n = ncounts;
+    for (int i = 0; i < n; i++) {
+        s.printf("%u\t%u\t%s (skipped)\n", counts[i].pgn, counts[i].count, name(counts[i].pgn));
+    }
+    if (skippedOther) {
+        s.printf("other\t%u\t(skipped)\n", skippedOther);
+    }
+}
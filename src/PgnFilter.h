@@ -0,0 +1,85 @@
+// Set of the PGNs we want to decode
+/*
+Copyright (c) 2024 Peter Martin www.naiadhome.com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include <Arduino.h>
+
+// Almost all the data PGNs are in 126976 - 131071 (0x1F000 - 0x1FFFF).
+// That range is held as a bitmap, anything outside it in a short list.
+#define PGNF_BASE 0x1F000
+#define PGNF_RANGE 0x1000
+#define PGNF_EXTRA 8
+
+// How many different skipped PGNs are counted individually
+#define PGNF_COUNTED 32
+
+// The set of PGNs whose frames are worth decoding. It is checked as soon as
+// the CAN id has been read so the data bytes of other frames are never
+// decoded. Skipped frames are counted per PGN.
+class PgnFilter {
+   public:
+    PgnFilter();
+
+    // Add a PGN to the set
+    void add(uint32_t pgn);
+
+    // Let everything through. Used when no set has been built.
+    void allowAll(bool all);
+
+    // True if frames for the PGN should be decoded
+    inline bool wants(uint32_t pgn) const {
+        if (all) {
+            return true;
+        }
+        uint32_t bit = pgn - PGNF_BASE;
+        if (bit < PGNF_RANGE) {
+            return bits[bit >> 3] & (1 << (bit & 7));
+        }
+        for (int i = 0; i < nextra; i++) {
+            if (extra[i] == pgn) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Count a frame that was not wanted
+    void skipped(uint32_t pgn);
+
+    // Print the counts of the frames skipped, one line per PGN
+    void printSkipped(Stream &s, const char *(*name)(uint32_t));
+
+    uint32_t skippedTotal = 0;  // All frames skipped
+    uint32_t skippedOther = 0;  // Skipped frames for PGNs not counted individually
+
+   private:
+    bool all = true;
+    uint8_t bits[PGNF_RANGE / 8];
+    uint32_t extra[PGNF_EXTRA];
+    int nextra = 0;
+
+    struct {
+        uint32_t pgn;
+        uint32_t count;
+    } counts[PGNF_COUNTED];
+    int ncounts = 0;
+};
@@ -0,0 +1,73 @@
+// Hash index over a constant table of PGN entries
+/*
+Copyright (c) 2024 Peter Martin www.naiadhome.com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+// Only standard headers so the index can be built and timed on a PC too.
+#include <stddef.h>
+#include <stdint.h>
+
+// Finds an entry in a table by its pgn member in one or two probes.
+// The table itself stays const. The index holds the table position + 1 of
+// each entry, 0 for an empty slot, and is filled in on first use because
+// C++11 can't build it at compile time. It must have at least twice as
+// many slots as the table has entries.
+template <typename T, size_t BITS>
+class PgnIndex {
+   public:
+    static const size_t SIZE = 1 << BITS;
+
+    constexpr PgnIndex(const T *table, size_t count) : table(table), count(count) {}
+
+    const T *find(uint32_t pgn) {
+        if (!built) {
+            build();
+        }
+        for (uint32_t h = hash(pgn); slots[h]; h = (h + 1) & (SIZE - 1)) {
+            const T *entry = &table[slots[h] - 1];
+            if (entry->pgn == pgn) {
+                return entry;
+            }
+        }
+        return NULL;
+    }
+
+   private:
+    static inline uint32_t hash(uint32_t pgn) {
+        return (pgn * 2654435761u) >> (32 - BITS);
+    }
+
+    void build() {
+        for (size_t i = 0; i < count; i++) {
+            uint32_t h = hash(table[i].pgn);
+            while (slots[h]) {
+                h = (h + 1) & (SIZE - 1);
+            }
+            slots[h] = i + 1;
+        }
+        built = true;
+    }
+
+    const T *table;
+    size_t count;
+    uint8_t slots[SIZE] = {};
+    bool built = false;
+};
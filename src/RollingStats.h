@@ -0,0 +1,78 @@
+// Min, mean and percentile of the most recent samples of a measurement
+/*
+Copyright (c) 2024 Peter Martin www.naiadhome.com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+
+// Summary of the samples held
+struct RollingSummary {
+    size_t count;
+    uint32_t min;
+    uint32_t mean;
+    uint32_t p99;
+    uint32_t max;
+};
+
+// Keeps the last N samples of a measurement. Adding a sample is cheap, the
+// work of sorting is only done when a summary is asked for.
+template <size_t N>
+class RollingStats {
+   public:
+    void add(uint32_t sample) {
+        samples[next] = sample;
+        next = (next + 1) % N;
+        if (count < N) {
+            count++;
+        }
+    }
+
+    size_t size() const { return count; }
+
+    RollingSummary summary() const {
+        RollingSummary s = {count, 0, 0, 0, 0};
+        if (!count) {
+            return s;
+        }
+        uint32_t sorted[N];
+        uint64_t total = 0;
+        for (size_t i = 0; i < count; i++) {
+            sorted[i] = samples[i];
+            total += samples[i];
+        }
+        // The smallest sample that at least 99% of the samples do not exceed.
+        // It only differs from the max once there are over 100 samples.
+        size_t rank = (count * 99 + 99) / 100 - 1;
+        std::nth_element(sorted, sorted + rank, sorted + count);
+        s.p99 = sorted[rank];
+        s.min = *std::min_element(sorted, sorted + count);
+        s.max = *std::max_element(sorted, sorted + count);
+        s.mean = total / count;
+        return s;
+    }
+
+   private:
+    uint32_t samples[N];
+    size_t next = 0;
+    size_t count = 0;
+};
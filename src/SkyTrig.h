@@ -0,0 +1,79 @@
+// Fixed point sin and cos for placing satellites in the sky view
+/*
+Copyright (c) 2024 Peter Martin www.naiadhome.com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+// Only standard headers so the geometry can be tested on a PC too.
+#include <stdint.h>
+
+// sin of 0 to 90 degrees in 1 degree steps, scaled by 2^14
+static const int16_t sinTable[91] = {
+        0,   286,   572,   857,  1143,  1428,  1713,  1997,  2280,  2563,
+     2845,  3126,  3406,  3686,  3964,  4240,  4516,  4790,  5063,  5334,
+     5604,  5872,  6138,  6402,  6664,  6924,  7182,  7438,  7692,  7943,
+     8192,  8438,  8682,  8923,  9162,  9397,  9630,  9860, 10087, 10311,
+    10531, 10749, 10963, 11174, 11381, 11585, 11786, 11982, 12176, 12365,
+    12551, 12733, 12911, 13085, 13255, 13421, 13583, 13741, 13894, 14044,
+    14189, 14330, 14466, 14598, 14726, 14849, 14968, 15082, 15191, 15296,
+    15396, 15491, 15582, 15668, 15749, 15826, 15897, 15964, 16026, 16083,
+    16135, 16182, 16225, 16262, 16294, 16322, 16344, 16362, 16374, 16382,
+    16384,
+};
+
+// sin of an angle in tenths of a degree, scaled by 2^14. The table is
+// interpolated between whole degrees.
+static inline int32_t isin(int32_t tenths) {
+    tenths %= 3600;
+    if (tenths < 0) {
+        tenths += 3600;
+    }
+    int32_t sign = 1;
+    if (tenths >= 1800) {
+        tenths -= 1800;
+        sign = -1;
+    }
+    if (tenths > 900) {
+        tenths = 1800 - tenths;
+    }
+    int32_t deg = tenths / 10;
+    int32_t frac = tenths % 10;
+    int32_t v = sinTable[deg];
+    if (frac) {
+        v += (sinTable[deg + 1] - v) * frac / 10;
+    }
+    return sign * v;
+}
+
+static inline int32_t icos(int32_t tenths) {
+    return isin(tenths + 900);
+}
+
+// Offset in pixels from the zenith of a satellite at an azimuth and
+// declination in degrees, for a sky view whose horizon is radius pixels
+// from the centre. x is to the east and y to the north.
+static inline void skyOffset(int32_t radius, double azimuth, double declination, int32_t &x, int32_t &y) {
+    // Work in tenths of a degree and pixels scaled by 2^14
+    int32_t az = azimuth * 10 + 0.5;
+    int32_t dec = declination * 10 + 0.5;
+    int32_t rad = radius * icos(dec);
+    x = ((int64_t)rad * isin(az) + (1 << 27)) >> 28;
+    y = ((int64_t)rad * icos(az) + (1 << 27)) >> 28;
+}
@@ -0,0 +1,101 @@
+// Lock free single producer, single consumer ring buffer
+/*
+Copyright (c) 2024 Peter Martin www.naiadhome.com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+// Only standard headers so the ring can be built and exercised on a PC too.
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// A fixed size ring for passing items from one task to another without locks.
+// Exactly one task may call the producer methods (push, claim, publish) and
+// exactly one other task the consumer methods (front, pop).
+// The head and tail counters run freely and are masked on use, so N must be
+// a power of 2. One item is never used, so the ring holds N - 1 items.
+template <typename T, size_t N>
+class SpscRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing size must be a power of 2");
+
+   public:
+    // Producer: copy an item in. Returns false and counts an overflow if full.
+    bool push(const T &item) {
+        T *slot = claim();
+        if (!slot) {
+            return false;
+        }
+        *slot = item;
+        publish();
+        return true;
+    }
+
+    // Producer: get the next free slot to fill in place, or NULL if full.
+    // The item is not seen by the consumer until publish() is called.
+    T *claim() {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= N - 1) {
+            overflows.fetch_add(1, std::memory_order_relaxed);
+            return NULL;
+        }
+        return &items[h & (N - 1)];
+    }
+
+    // Producer: hand the claimed slot over to the consumer
+    void publish() {
+        uint32_t h = head.load(std::memory_order_relaxed) + 1;
+        head.store(h, std::memory_order_release);
+
+        uint32_t used = h - tail.load(std::memory_order_relaxed);
+        if (used > highWater.load(std::memory_order_relaxed)) {
+            highWater.store(used, std::memory_order_relaxed);
+        }
+    }
+
+    // Consumer: the oldest item or NULL if the ring is empty.
+    // It stays valid until pop() is called.
+    T *front() {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (head.load(std::memory_order_acquire) == t) {
+            return NULL;
+        }
+        return &items[t & (N - 1)];
+    }
+
+    // Consumer: release the item returned by front()
+    void pop() {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Number of items waiting. Exact only when called from one of the two tasks.
+    size_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t capacity() { return N - 1; }
+
+    std::atomic<uint32_t> highWater{0};  // Most items that have been waiting at once
+    std::atomic<uint32_t> overflows{0};  // Items that were refused because the ring was full
+
+   private:
+    T items[N];
+    std::atomic<uint32_t> head{0};  // Next slot to fill. Only written by the producer.
+    std::atomic<uint32_t> tail{0};  // Next slot to empty. Only written by the consumer.
+};
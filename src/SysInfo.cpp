@@ -27,6 +27,8 @@ OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <NMEA0183Messages.h>
 #include <SysInfo.h>
 #include <esp_wifi.h>
+#include <YDtoN2kUDP.h>
+#include <handlePGN.h>
 
 #include "uptime_formatter.h"
 #include <Version.h>
@@ -83,7 +85,9 @@ void getSysInfo(Stream &s) {
 }
 
 // Get the N2k messages and their counts and send to the configured output stream.
+// The frames dropped by the ingest filter are listed after the ones handled.
 extern std::map<int, int> N2kMsgMap;
+extern YDtoN2kUDP ydtoN2kUDP;
 void getN2kMsgs(Stream &s) {
     std::map<int, int>::iterator it = N2kMsgMap.begin();
 
@@ -91,68 +95,9 @@ void getN2kMsgs(Stream &s) {
     s.printf("PGN\tCount\tFunction\n");
 
     while (it != N2kMsgMap.end()) {
-        const char *name = "unknown";
-        switch (it->first) {
-            case 127488:
-                name = "Engine Rapid";
-                break;
-            case 127508:
-                name = "Battery Status";
-                break;
-            case 127513:
-                name = "Battery Configuration";
-                break;
-            case 60928:
-                name = "IsoAddress";
-                break;
-            case 126992:
-                name = "System Time";
-                break;
-            case 126996:
-                name = "Product Information";
-                break;
-            case 127250:
-                name = "Magnetic Heading";
-                break;
-            case 127489:
-                name = "Engine Dynamic";
-                break;
-            case 130306:
-                name = "Wind Data";
-                break;
-            case 128267:
-                name = "Depth Data";
-                break;
-            case 129026:
-                name = "COG/SOG";
-                break;
-            case 130310:
-                name = "Outside environment";
-                break;
-            case 130311:
-                name = "Environmental Parameters";
-                break;
-            case 130312:
-                name = "Temperature";
-                break;
-            case 130313:
-                name = "Humidity";
-                break;
-            case 130314:
-                name = "Pressure";
-                break;
-            case 129029:
-                name = "GNSS";
-                break;
-            case 129539:
-                name = "GNSS DOP";
-                break;
-            case 129540:
-                name = "GNSS Sats in view";
-                break;
-        }
-        s.printf("%d\t%d\t%s\n", it->first, it->second, name);
+        s.printf("%d\t%d\t%s\n", it->first, it->second, pgnName(it->first));
         it++;
     }
+    ydtoN2kUDP.filter.printSkipped(s, pgnName);
     s.println("=========== END ==========");
-}
\ No newline at end of file
+}
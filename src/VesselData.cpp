@@ -0,0 +1,143 @@
+// Store of the latest vessel data values
+/*
+Copyright (c) 2024 Peter Martin www.naiadhome.com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <VesselData.h>
+
+static ChannelSlot slots[CH_MAX];
+static SatSlot sats[VD_MAXSATS];
+static uint32_t satSeq;
+
+// Names and units for the listings. In the same order as Channel.
+static const struct {
+    const char *name;
+    const char *units;
+} channelInfo[CH_MAX] = {
+    {"House V", "V"},
+    {"House I", "A"},
+    {"Engine V", "V"},
+    {"RPM", "rpm"},
+    {"SOG", "kts"},
+    {"COG", "°"},
+    {"Depth", "m"},
+    {"Wind angle", "°"},
+    {"Wind speed", "kts"},
+    {"Satellites", ""},
+    {"HDOP", ""},
+    {"Air temp", "°C"},
+    {"Sea temp", "°C"},
+    {"Humidity", "%"},
+    {"Pressure", "mbar"},
+};
+
+void vdSet(Channel ch, float value, uint8_t source) {
+    ChannelSlot &slot = slots[ch];
+    slot.value = value;
+    slot.time = millis();
+    slot.source = source;
+    slot.seq++;
+}
+
+const ChannelSlot &vdGet(Channel ch) {
+    return slots[ch];
+}
+
+uint32_t vdAge(Channel ch) {
+    if (slots[ch].seq == 0) {
+        return UINT32_MAX;
+    }
+    return millis() - slots[ch].time;
+}
+
+bool vdStale(Channel ch) {
+    return vdAge(ch) > VD_STALE;
+}
+
+const char *vdName(Channel ch) {
+    return channelInfo[ch].name;
+}
+
+const char *vdUnits(Channel ch) {
+    return channelInfo[ch].units;
+}
+
+void vdSetSat(uint8_t prn, float snr, float azimuth, float elevation) {
+    if (prn == 0) {
+        return;
+    }
+    uint32_t now = millis();
+    int idx = -1, free = -1, oldest = 0;
+    for (int i = 0; i < VD_MAXSATS; i++) {
+        if (sats[i].prn == prn) {
+            idx = i;
+            break;
+        }
+        if (sats[i].prn == 0) {
+            if (free < 0) {
+                free = i;
+            }
+        } else if (now - sats[i].time > now - sats[oldest].time) {
+            oldest = i;
+        }
+    }
+    if (idx < 0) {
+        idx = free >= 0 ? free : oldest;
+    }
+    SatSlot &sat = sats[idx];
+    sat.prn = prn;
+    sat.snr = snr;
+    sat.azimuth = azimuth;
+    sat.elevation = elevation;
+    sat.time = now;
+    satSeq++;
+}
+
+const SatSlot *vdSats() {
+    return sats;
+}
+
+uint32_t vdSatSeq() {
+    return satSeq;
+}
+
+void getVesselData(Stream &s) {
+    s.println("=========== DATA ==========");
+    s.printf("Channel\t\tValue\tSource\tAge ms\tUpdates\n");
+    for (int i = 0; i < CH_MAX; i++) {
+        Channel ch = (Channel)i;
+        const ChannelSlot &slot = slots[ch];
+        if (slot.seq == 0) {
+            s.printf("%-12s\t---\n", vdName(ch));
+        } else {
+            s.printf("%-12s\t%.2f%s\t%u\t%u%s\t%u\n", vdName(ch), slot.value, vdUnits(ch),
+                     slot.source, vdAge(ch), vdStale(ch) ? " (stale)" : "", slot.seq);
+        }
+    }
+    s.printf("PRN\tSNR\tAz\tEl\tAge ms\n");
+    for (int i = 0; i < VD_MAXSATS; i++) {
+        const SatSlot &sat = sats[i];
+        if (sat.prn) {
+            s.printf("%u\t%.0f\t%.0f\t%.0f\t%u\n", sat.prn, sat.snr, sat.azimuth, sat.elevation,
+                     millis() - sat.time);
+        }
+    }
+    s.println("=========== END ==========");
+}
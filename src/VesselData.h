@@ -0,0 +1,97 @@
+// Store of the latest vessel data values
+/*
+Copyright (c) 2024 Peter Martin www.naiadhome.com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include <Arduino.h>
+
+// The data channels. One slot each in the store.
+typedef enum {
+    CH_HOUSEV,
+    CH_HOUSEI,
+    CH_ENGINEV,
+    CH_RPM,
+    CH_SOG,
+    CH_COG,
+    CH_DEPTH,
+    CH_WINDANGLE,
+    CH_WINDSPEED,
+    CH_SATS,
+    CH_HDOP,
+    CH_AIRTEMP,
+    CH_SEATEMP,
+    CH_HUMIDITY,
+    CH_PRESSURE,
+    CH_MAX
+} Channel;
+
+// A value older than this many ms is stale
+#define VD_STALE 10000
+
+// One channel. Kept small so the whole store sits in a few cache lines.
+typedef struct {
+    float value;    // In the display units given by vdUnits()
+    uint32_t time;  // millis() when it was last set
+    uint32_t seq;   // Bumped every time it is set. 0 if never set.
+    uint8_t source; // N2K source address it came from
+} ChannelSlot;
+
+// The decoders write the values here and nothing else. The display, logging,
+// web pages and so on read them when they want to, so none of them have
+// to keep up with the rate the messages arrive.
+// Both sides run in the main loop so no locking is needed.
+void vdSet(Channel ch, float value, uint8_t source);
+
+// Read a channel
+const ChannelSlot &vdGet(Channel ch);
+
+// ms since the channel was set, or UINT32_MAX if it never has been
+uint32_t vdAge(Channel ch);
+bool vdStale(Channel ch);
+
+const char *vdName(Channel ch);
+const char *vdUnits(Channel ch);
+
+// The satellites in view. Receivers split them over several messages, so
+// each is kept with the time it was last reported rather than replaced as
+// a list.
+#define VD_MAXSATS 64
+
+typedef struct {
+    float snr;          // dB
+    float azimuth;      // Degrees
+    float elevation;    // Degrees
+    uint32_t time;      // millis() when it was last reported
+    uint8_t prn;        // 0 if the entry is free
+} SatSlot;
+
+// Set a satellite, taking the entry of the one heard from longest ago if
+// the table is full
+void vdSetSat(uint8_t prn, float snr, float azimuth, float elevation);
+
+// The table, VD_MAXSATS entries
+const SatSlot *vdSats();
+
+// Bumped every time a satellite is set
+uint32_t vdSatSeq();
+
+// List the channels with their values and ages
+void getVesselData(Stream &s);
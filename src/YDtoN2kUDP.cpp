@@ -4,7 +4,9 @@
 // 1. Instantiate an object of this class.
 // 2. Once you have a network up and running - eg wifi. call the begin method with the port.
 // 3. Read the data periodically into the caller supplied n2kmsg object . 
-// If there is no data then the read method returns false and the caller's ns2msg object is untouched.
+// If there is no data then the read method returns false. Lines that were skipped or could not be
+// decoded on the way may have overwritten parts of the caller's n2kmsg object, so it only holds a
+// message after a true return.
 // 
 // //////////////////////////////////////////////////////////////////////////////////////////////////
 /*
@@ -31,7 +33,7 @@ OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //////////////////////////////////////////////////////////////////////////////////////////////////
 
 
-#include <YDtoN2KUDP.h>
+#include <YDtoN2kUDP.h>
 #include <GwLogger.h>
 
 // Constructor
@@ -43,93 +45,195 @@ void YDtoN2kUDP::begin(uint16_t port) {
     wifiUdp.begin(port);
 }
 
-// read the YD data from the UDP port. If no data return false
-// otherwise decode the data into the callers supplied object
-bool YDtoN2kUDP::readYD(tN2kMsg &msgout)
-{
+// Value of a hex digit or -1 if the character is not one
+static inline int hexDigit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c |= 0x20;  // Fold to lower case
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+// Decode one YD RAW line straight into msg. The line looks like
+//   17:33:21.107 R 19F51323 01 02 03 04 05 06 07 08
+// i.e. time, direction, CAN id and up to 8 data bytes, all in hex.
+// The buffer is walked once with no copying. On return p points at the start
+// of the next line whether or not this one could be decoded.
+YDResult YDtoN2kUDP::parseLine(const char *&p, const char *end, tN2kMsg &msg,
+                               const PgnFilter *filter) {
+    const char *s = p;
+    YDResult result = YD_BAD;
+
+    // Skip the time and the direction fields
+    for (int field = 0; field < 2; field++) {
+        while (s < end && *s == ' ') s++;
+        const char *start = s;
+        while (s < end && *s > ' ') s++;
+        if (s == start) {
+            goto skip;
+        }
+    }
+
+    {
+        // The CAN id. Up to 8 hex digits
+        uint32_t canId = 0;
+        int digits = 0;
+        int v;
+        while (s < end && *s == ' ') s++;
+        while (s < end && (v = hexDigit(*s)) >= 0) {
+            canId = (canId << 4) | v;
+            s++;
+            digits++;
+        }
+        if (digits == 0 || digits > 8 || (s < end && *s > ' ')) {
+            goto skip;
+        }
+
+        // PDU1 PGNs are sent to one address, which is the low byte of the
+        // PGN field. PDU2 PGNs are broadcast.
+        uint32_t pgn = (canId >> 8) & 0x3ffff;
+        uint8_t destination = 0xff;
+        if (((pgn >> 8) & 0xff) < 240) {
+            destination = pgn & 0xff;
+            pgn &= 0x3ff00;
+        }
+
+        // Drop frames we have no use for before decoding the data.
+        // The PGN is still passed back so it can be counted.
+        if (filter && !filter->wants(pgn)) {
+            msg.SetPGN(pgn);
+            result = YD_SKIPPED;
+            goto skip;
+        }
+
+        // The data bytes. Each one must be exactly 2 hex digits.
+        int len = 0;
+        while (true) {
+            while (s < end && *s == ' ') s++;
+            if (s >= end || *s < ' ') {
+                break;  // End of line
+            }
+            int hi, lo;
+            if (len >= 8 || end - s < 2 || (hi = hexDigit(s[0])) < 0 || (lo = hexDigit(s[1])) < 0) {
+                goto skip;
+            }
+            s += 2;
+            if (s < end && *s > ' ') {
+                goto skip;
+            }
+            msg.Data[len++] = (hi << 4) | lo;
+        }
+
+        // Unpack the CAN ID into it parts and build the n2kmsg object
+        // The format is explained here https://endige.com/2050/nmea-2000-pgns-deciphered/
+        // The source is the bottom 8 bits
+        msg.Source = canId & 0xff;
+        msg.Priority = (canId >> 26) & 0x7;
+        msg.Destination = destination;
+        msg.SetPGN(pgn);
+        msg.DataLen = len;
+        result = YD_OK;
+    }
+
+skip:
+    // Move on to the start of the next line
+    while (s < end && *s != '\n') s++;
+    while (s < end && (*s == '\n' || *s == '\r')) s++;
+    p = s;
+    return result;
+}
+
+// Read the next datagram from the UDP port into packetBuffer and point
+// the line cursor at it. Returns false if there is nothing waiting.
+bool YDtoN2kUDP::nextDatagram() {
   static uint32_t seq = 0;      // Used for debugging
   static const int debug = 0;   // Set to 1 for debug messages
   static const int debug2 = 0;  // set to 1 to print the YD messages only
-  bool hadpacket = false;       // Return value
 
-    // Read and parse the data from the UDP port.
+  // Read the data from the UDP port.
   int packetSize = wifiUdp.parsePacket();
-  if (packetSize) {
-    if(debug) {
-      Serial.printf("Received packet %d of size %d", seq++, packetSize);
-      Serial.print("From ");
-      IPAddress remoteIp = wifiUdp.remoteIP();
-      Serial.println(remoteIp);
-    }
+  if (!packetSize) {
+    return false;
+  }
 
-    // read the packet into packetBufffer
-    int len = wifiUdp.read(packetBuffer, N2K_PKT_SIZE);
-    if (len > 0) {
-      packetBuffer[len] = 0;
-    }
+  if(debug) {
+    Serial.printf("Received packet %d of size %d", seq++, packetSize);
+    Serial.print("From ");
+    IPAddress remoteIp = wifiUdp.remoteIP();
+    Serial.println(remoteIp);
+  }
 
-    if(debug2) {
-      // Packet already has new line
-      unsigned long now = millis();
+  // read the packet into packetBufffer
+  int len = wifiUdp.read(packetBuffer, N2K_PKT_SIZE);
+  if (len <= 0) {
+    len = 0;
+  }
+  packetBuffer[len] = 0;
 
-      Serial.print(now);
-      Serial.print(" ");
-      Serial.print(packetBuffer);
-    }
- 
-    // Break the message into components.
-    char * word;
-    const char * sep = " ";
-    char * lasts;
-    int i = 0;
-    const uint16_t maxwords = 64;
-    const uint16_t maxlen   = 16;
-    char words[maxwords][maxlen];
-
-    for (word = strtok_r(packetBuffer, sep, &lasts);
-                word && i < maxwords;
-                word = strtok_r(NULL, sep, &lasts), i++) {
-        strncpy(words[i], word, maxlen - 1);
-        if(debug2) {
-            Serial.printf(" (%d) %s", i, word);
-        }
-    }
+  if(debug2) {
+    // Packet already has new line
+    unsigned long now = millis();
 
-    if(debug2) {
-        Serial.println();
-        Serial.printf("Len %d\n", i);
-    }
+    Serial.print(now);
+    Serial.print(" ");
+    Serial.print(packetBuffer);
+  }
 
-    // Unpack the CAN ID into it parts and build the n2kmsg object
-    // The format is explained here https://endige.com/2050/nmea-2000-pgns-deciphered/
-    if(i > 2) {
-      // word[0] = time
-      // word[1] = direction
-      // word[2] = canid
-      // word[3 to maxwords-1] = data values
-
-      // Get the canId and extract the sender station and the PGN
-      // The source is the bottom 8 bits
-      uint32_t canId = strtoul((const char *) words[2], NULL, 16);
-      uint32_t len = i - 3; 
-
-      uint32_t source = canId & 0xff;
-      uint32_t PGN = (canId >> 8) & 0x3ffff;
-      uint32_t PRIO = (canId >> 26) & 0x7;
-     
-      msgout.Source = source;
-      msgout.Priority = PRIO;
-      msgout.SetPGN(PGN);
-      msgout.DataLen = len;
-      for(int j = 0; j < len; j++) {
-        msgout.Data[j] = strtoul((const char *)words[j+3], NULL, 16) & 0xff;
-    }
-    if(debug) {
-      Serial.printf("SRC %d PGN %d\n", source, PGN);
-    }
-    hadpacket = true;
+  // Close off the counts for the previous datagram
+  if (datagrams) {
+    lastLines = curLines;
+    if (curLines > maxLines) {
+      maxLines = curLines;
     }
   }
-  return hadpacket;
+  curLines = 0;
+  datagrams++;
+
+  cursor = packetBuffer;
+  bufEnd = packetBuffer + len;
+  return true;
 }
 
+// read the YD data from the UDP port. If no data return false
+// otherwise decode the data into the callers supplied object.
+// A datagram may hold several lines. They are returned one per call
+// before the next datagram is read.
+bool YDtoN2kUDP::readYD(tN2kMsg &msgout)
+{
+  do {
+    while (cursor < bufEnd) {
+      // Skip any blank lines
+      if (*cursor == '\r' || *cursor == '\n') {
+        cursor++;
+        continue;
+      }
+      switch (parseLine(cursor, bufEnd, msgout, &filter)) {
+        case YD_OK:
+          frames++;
+          curLines++;
+          return true;
+        case YD_SKIPPED:
+          filter.skipped(msgout.PGN);
+          break;
+        case YD_BAD:
+          malformed++;
+          break;
+      }
+    }
+  } while (nextDatagram());
+
+  return false;
+}
+
+// Print the reader counters
+void YDtoN2kUDP::printStats(Stream &s) {
+    s.printf("YD frames\t%u\n", frames);
+    s.printf("YD malformed\t%u\n", malformed);
+    s.printf("YD skipped\t%u\n", filter.skippedTotal);
+    s.printf("YD datagrams\t%u\n", datagrams);
+    s.printf("Lines/datagram\t%.2f (last %u max %u)\n",
+             datagrams ? (float)frames / datagrams : 0.0, lastLines, maxLines);
+}
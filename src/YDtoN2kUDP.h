@@ -24,16 +24,50 @@ OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <N2kMessages.h>
 #include <N2kMsg.h>
 #include <WiFi.h>
+#include <PgnFilter.h>
 
 #define N2K_PKT_SIZE 1460
 
+// Result of decoding one line
+typedef enum {
+    YD_OK,       // Decoded into the message
+    YD_SKIPPED,  // Valid but the PGN is not in the filter
+    YD_BAD       // Could not be decoded
+} YDResult;
+
 class YDtoN2kUDP {
    public:
     YDtoN2kUDP();
     void begin(uint16_t port);
     bool readYD(tN2kMsg &N2kMsg);
 
+    // Decode a single YD RAW line into msg. p is advanced past the line.
+    // If a filter is given the data bytes are only decoded for PGNs it wants.
+    // Only YD_OK leaves a whole message in msg. YD_SKIPPED sets just its PGN
+    // and YD_BAD may leave some data bytes written.
+    static YDResult parseLine(const char *&p, const char *end, tN2kMsg &msg,
+                              const PgnFilter *filter = NULL);
+
+    // Print the reader counters
+    void printStats(Stream &s);
+
+    uint32_t frames = 0;     // Lines decoded into messages
+    uint32_t malformed = 0;  // Lines that could not be decoded
+    uint32_t datagrams = 0;  // UDP datagrams read
+    uint16_t lastLines = 0;  // Lines decoded from the last complete datagram
+    uint16_t maxLines = 0;   // Most lines decoded from one datagram
+
+    // The PGNs to decode. Set up before the reading starts.
+    PgnFilter filter;
+
    private:
+    bool nextDatagram();
+
     WiFiUDP wifiUdp;
-    char packetBuffer[N2K_PKT_SIZE];  // buffer to hold incoming packet
+    char packetBuffer[N2K_PKT_SIZE + 1];  // buffer to hold incoming packet plus a terminator
+
+    // Cursor over the lines in the current datagram
+    const char *cursor = packetBuffer;
+    const char *bufEnd = packetBuffer;
+    uint16_t curLines = 0;
 };
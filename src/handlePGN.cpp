@@ -29,7 +29,8 @@ OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <handlePGN.h>
 #include <StringStream.h>
 #include <GwLogger.h>
-#include <ArduinoJson.h>
+#include <VesselData.h>
+#include <PgnIndex.h>
 
 // Display handlers
 #include <tftscreen.h>
@@ -38,18 +39,22 @@ OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <ESP32Time.h>
 
 #include <time.h>
+#include <sys/time.h>
 
 static  ESP32Time rtc;
 
 // Update the time displayed on the screen.
 // Uses the internal system time which will have been updated
 // if the GPS has provided a clock.
-// Only update if the seconds have changed
-void updateTime() {
+// Only update if the seconds have changed. While the GNSS screen is hidden
+// the text is only held, and drawn when the screen is loaded.
+uint32_t updateTime() {
     static time_t last = 0;
     struct tm tm;
     char buf[10];
-    time_t now = time(NULL);
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    time_t now = tv.tv_sec;
     gmtime_r(&now, &tm);
 
     if(now > last) {
@@ -57,310 +62,331 @@ void updateTime() {
         snprintf(buf, 9, "%02d:%02d:%02d", tm.tm_hour, tm.tm_min, tm.tm_sec);
         setMeter(SCR_GNSS, TIME, buf);
     }
+    return 1000 - tv.tv_usec / 1000;
 }
 
-// Function to return a String objcet formatted to a fixed number of decimal places
-String dpf(double val, int dp = 2) {
-    String result(val, 2);
-    return result;
+#define SECONDS_IN_DAY (60 * 60 * 24)
+
+// The decoders for each PGN. Each one parses the message, puts the values
+// in the vessel data store and adds them to the log record.
+// The displays pick the values up from the store.
+
+// Battery Status
+static void decode127508(const tN2kMsg &msg, LogRecord &record) {
+    unsigned char instance = 0xff;
+    double voltage = 0.0;
+    double current = 0.0;
+    double temp = 273.0;
+    unsigned char SID = 0xff;
+    bool s = ParseN2kPGN127508(msg, instance, voltage, current, temp, SID);
+
+    if (s && voltage != N2kDoubleNA && current != N2kDoubleNA) {
+        switch (instance) {
+            case 0:
+                vdSet(CH_HOUSEV, voltage, msg.Source);
+                vdSet(CH_HOUSEI, current, msg.Source);
+                record.add("instance", (int32_t)instance);
+                record.add("housev", voltage, 2);
+                record.add("housei", current, 2);
+                break;
+            case 1:
+                vdSet(CH_ENGINEV, voltage, msg.Source);
+                record.add("instance", (int32_t)instance);
+                record.add("enginev", voltage, 2);
+                break;
+        }
+    }
+}
+
+// Engine Rapid
+static void decode127488(const tN2kMsg &msg, LogRecord &record) {
+    unsigned char instance;
+    double speed;
+    double boost;
+    int8_t trim;
+    bool s = ParseN2kPGN127488(msg, instance, speed, boost, trim);
+    if(s && speed != N2kDoubleNA) {
+        vdSet(CH_RPM, speed, msg.Source);
+        record.add("rpm", (int32_t)speed / 100);
+    }
+}
+
+// Wind
+static void decode130306(const tN2kMsg &msg, LogRecord &record) {
+    double windSpeed;
+    double windAngle;
+    unsigned char instance;
+    tN2kWindReference ref;
+    bool s = ParseN2kPGN130306(msg, instance, windSpeed, windAngle, ref);
+    if(s && windAngle != N2kDoubleNA) {
+        vdSet(CH_WINDANGLE, RadToDeg(windAngle), msg.Source);
+        record.add("angle", (int32_t)RadToDeg(windAngle) + 180);
+    }
+    if(s && windSpeed != N2kDoubleNA) {
+        vdSet(CH_WINDSPEED, msToKnots(windSpeed), msg.Source);
+        record.add("wind", msToKnots(windSpeed), 1);
+    }
+}
+
+// COG/SOG
+static void decode129026(const tN2kMsg &msg, LogRecord &record) {
+    unsigned char instance;
+    tN2kHeadingReference ref;
+    double hdg;
+    double sog;
+    bool s = ParseN2kPGN129026(msg, instance, ref, hdg, sog);
+    if(s && sog != N2kDoubleNA) {
+        vdSet(CH_SOG, msToKnots(sog), msg.Source);
+        record.add("sog", msToKnots(sog), 1);
+    }
+    if(s && hdg != N2kDoubleNA) {
+        vdSet(CH_COG, RadToDeg(hdg), msg.Source);
+        record.add("cog", (int32_t)RadToDeg(hdg));
+    }
 }
 
+// Depth
+static void decode128267(const tN2kMsg &msg, LogRecord &record) {
+    unsigned char instance;
+    double depth;
+    double offset;
+    double range;
+    bool s = ParseN2kPGN128267(msg, instance, depth, offset, range);
+    if(s && depth != N2kDoubleNA) {
+        vdSet(CH_DEPTH, depth, msg.Source);
+        record.add("depth", depth, 1);
+    }
+}
+
+// GNSS position and time
+static void decode129029(const tN2kMsg &msg, LogRecord &record) {
+    unsigned char instance;
+    uint16_t DaysSince1970;
+    double SecondsSinceMidnight;
+    double Latitude;
+    double Longitude;
+    double Altitude;
+    tN2kGNSStype GNSStype;
+    tN2kGNSSmethod GNSSmethod;
+    unsigned char nSatellites;
+    double Hdop;
+    double PDOP;
+    double GeoidalSeparation;
+    unsigned char nReferenceStations;
+    tN2kGNSStype ReferenceStationType;
+    uint16_t ReferenceSationID;
+    double AgeOfCorrection;
+
+    bool s = ParseN2kPGN129029(msg, instance, DaysSince1970, SecondsSinceMidnight, Latitude,
+                               Longitude, Altitude, GNSStype, GNSSmethod, nSatellites, Hdop, PDOP, GeoidalSeparation,
+                               nReferenceStations, ReferenceStationType, ReferenceSationID, AgeOfCorrection);
+
+    // Convert seconds since midnight to HH:MM:SS
+    // Check we have valid values!
+    if (s && DaysSince1970 !=  N2kUInt16NA && SecondsSinceMidnight != N2kDoubleNA) {
+        uint16_t seconds, minutes, hours;
+        uint32_t t = SecondsSinceMidnight;
+        seconds = t % 60;
+        t = (t - seconds) / 60;
+        minutes = t % 60;
+        hours = (t - minutes) / 60;
+        char buf[10];
+        snprintf(buf, 9, "%02d:%02d:%02d", hours, minutes, seconds);
+
+        vdSet(CH_HDOP, Hdop, msg.Source);
+
+        record.add("lat", Latitude, 7);
+        record.add("lon", Longitude, 7);
+        record.add("time", buf);
+        record.add("days", (int32_t)DaysSince1970);
+        record.add("seconds", SecondsSinceMidnight, 3);
+
+        time_t now = (DaysSince1970 * SECONDS_IN_DAY) + SecondsSinceMidnight;
+        struct tm tm;
+        gmtime_r(&now, &tm);
+
+        // Update the system time
+        rtc.setTime(tm.tm_sec, tm.tm_min, tm.tm_hour, tm.tm_mday, tm.tm_mon + 1, tm.tm_year + 1900);
+    }
+}
+
+// GNSS satellites in view
+static void decode129540(const tN2kMsg &msg, LogRecord &record) {
+    unsigned char instance;
+    tN2kRangeResidualMode Mode;
+    uint8_t NumberOfSVs;
+
+    // First get the number of satellites in view
+    bool s = ParseN2kPGN129540(msg, instance, Mode, NumberOfSVs);
+
+    if (!s) {
+        return;
+    }
+    // Now for each satellite index get the details
+    for (int i = 0; i < NumberOfSVs; i++) {
+        tSatelliteInfo SatelliteInfo;
+
+        if (ParseN2kPGN129540(msg, i, SatelliteInfo)) {
+            vdSetSat(SatelliteInfo.PRN, SatelliteInfo.SNR, RadToDeg(SatelliteInfo.Azimuth),
+                     RadToDeg(SatelliteInfo.Elevation));
+        }
+    }
+
+    vdSet(CH_SATS, NumberOfSVs, msg.Source);
+}
+
+// Outside Environmental
+static void decode130310(const tN2kMsg &msg, LogRecord &record) {
+    unsigned char instance;
+    double WaterTemperature;
+    double OutsideAmbientAirTemperature;
+    double AtmosphericPressure;
+
+    bool s = ParseN2kPGN130310(msg, instance, WaterTemperature, OutsideAmbientAirTemperature, AtmosphericPressure);
+
+    if(s && WaterTemperature > 273.0) {
+        vdSet(CH_SEATEMP, KelvinToC(WaterTemperature), msg.Source);
+        record.add("seatemp", KelvinToC(WaterTemperature), 1);
+    }
+}
+
+// Temperature
+static void decode130312(const tN2kMsg &msg, LogRecord &record) {
+    unsigned char instance;
+    unsigned char TempInstance;
+    tN2kTempSource TempSource;
+    double ActualTemperature;
+    double SetTemperature;
+
+    bool s = ParseN2kPGN130312(msg, instance, TempInstance, TempSource, ActualTemperature, SetTemperature);
+
+    if(s && ActualTemperature != 0.01) {
+        vdSet(CH_AIRTEMP, KelvinToC(ActualTemperature), msg.Source);
+        record.add("airtemp", KelvinToC(ActualTemperature), 1);
+    }
+}
+
+// Humidity
+static void decode130313(const tN2kMsg &msg, LogRecord &record) {
+    unsigned char instance;
+    unsigned char HumidityInstance;
+    tN2kHumiditySource HumiditySource;
+    double ActualHumidity;
+
+    bool s = ParseN2kPGN130313(msg, instance, HumidityInstance, HumiditySource, ActualHumidity);
+
+    if(s && ActualHumidity != N2kDoubleNA) {
+        vdSet(CH_HUMIDITY, ActualHumidity, msg.Source);
+    }
+}
+
+// Pressure
+static void decode130314(const tN2kMsg &msg, LogRecord &record) {
+    unsigned char instance;
+    unsigned char PressureInstance;
+    tN2kPressureSource PressureSource;
+    double Pressure;
+
+    bool s = ParseN2kPGN130314(msg, instance, PressureInstance, PressureSource, Pressure);
+
+    if(s && Pressure != 0.01) {
+        vdSet(CH_PRESSURE, Pressure / 100, msg.Source);
+        record.add("pressure", (int32_t)Pressure / 100);
+    }
+}
+
+// The PGN registry. One entry for each PGN we know about. Those with a
+// decoder are read and handled, the rest are only named in the listings.
+// Where the values are shown is set by the display's views, and what is
+// logged by the decoder. To handle a new PGN write its decoder and add it here.
+static const PgnHandler pgnHandlers[] = {
+    // PGN   Name                        Decoder
+    {127488, "Engine Rapid",             decode127488},
+    {127508, "Battery Status",           decode127508},
+    {128267, "Depth Data",               decode128267},
+    {129026, "COG/SOG",                  decode129026},
+    {129029, "GNSS",                     decode129029},
+    {129540, "GNSS Sats in view",        decode129540},
+    {130306, "Wind Data",                decode130306},
+    {130310, "Outside environment",      decode130310},
+    {130312, "Temperature",              decode130312},
+    {130313, "Humidity",                 decode130313},
+    {130314, "Pressure",                 decode130314},
+
+    {60928,  "IsoAddress",               NULL},
+    {126992, "System Time",              NULL},
+    {126996, "Product Information",      NULL},
+    {127250, "Magnetic Heading",         NULL},
+    {127489, "Engine Dynamic",           NULL},
+    {127513, "Battery Configuration",    NULL},
+    {129539, "GNSS DOP",                 NULL},
+    {130311, "Environmental Parameters", NULL},
+};
+
+#define NUM_HANDLERS (sizeof(pgnHandlers) / sizeof(pgnHandlers[0]))
+
+// Hash index into the registry so a lookup is one or two probes
+#define PGN_INDEX_BITS 6
+static_assert(NUM_HANDLERS < (1 << PGN_INDEX_BITS) / 2, "PGN hash index is too small");
+static PgnIndex<PgnHandler, PGN_INDEX_BITS> pgnIndex(pgnHandlers, NUM_HANDLERS);
+
+const PgnHandler *findPgnHandler(uint32_t pgn) {
+    return pgnIndex.find(pgn);
+}
+
+size_t getPgnHandlers(const PgnHandler **list) {
+    *list = pgnHandlers;
+    return NUM_HANDLERS;
+}
+
+// The name of a PGN for the message listings
+const char *pgnName(uint32_t pgn) {
+    const PgnHandler *handler = findPgnHandler(pgn);
+    return handler ? handler->name : "unknown";
+}
+
+// The log record is reused for every message
+static LogRecord record;
+
 void handlePGN(tN2kMsg& msg) {
-    // get the current system time and format with YYY-MM-DD HH:MM:SS
-    // this is the primary key for each log entry.
-    time_t now = time(NULL);
-    char buf[25];
-    struct tm tm;
-    gmtime_r(&now, &tm);
-        snprintf(buf, sizeof(buf), "%d-%d-%d %d:%d:%d",
-        tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
-        tm.tm_hour, tm.tm_min, tm.tm_sec);
-
-   // Base object for logging
-    JsonDocument doc;
-    doc["PGN"] = msg.PGN;
-    doc["ms"] = millis();
-
-    // Add a record for the data found
-    JsonObject record = doc[buf].to<JsonObject>();
-
-    // Flag to indicate we actually wrote some data.
-    bool hadData = true;   // We negate this in the default case below
-
-     switch (msg.PGN) {
-        case 127508: {
-            // Battery Status
-            unsigned char instance = 0xff;
-            double voltage = 0.0;
-            double current = 0.0;
-            double temp = 273.0;
-            unsigned char SID = 0xff;
-            bool s = ParseN2kPGN127508(msg, instance, voltage, current, temp, SID);
-
-            if (s && voltage != N2kDoubleNA && current != N2kDoubleNA) {
-                switch (instance) {
-                    case 0:
-                        setMeter(SCR_ENGINE, HOUSEV, voltage, "V");
-                        setMeter(SCR_ENGINE, HOUSEI, current, "A");
-                        record["instance"]  = instance;
-                        record["housev"] = voltage;
-                        record["housei"] = current;
-                        break;
-                    case 1:
-                        setMeter(SCR_ENGINE, ENGINEV, voltage, "V");
-                        record["instance"]  = instance;
-                        record["enginev"] = voltage;
-                        ;
-                        break;
-                }
-            }
-        } break;
-
-        case 127513:
-            // Not interested
-            break;
-
-        case 127488: {
-            // Engine Rapid
-            unsigned char instance;
-            double speed;
-            double boost;
-            int8_t trim;
-            bool s = ParseN2kPGN127488(msg, instance, speed, boost, trim);
-            if(s && speed != N2kDoubleNA) {
-                setGauge(SCR_ENGINE, speed / 100);
-                String es(speed, 0);
-                es += "rpm";
-                setVlabel(SCR_ENGINE, es);
-                record["rpm"] = (int)speed / 100;
-            }
-        } break;
-
-        case 130306: {
-            // Wind
-            double windSpeed;
-            double windAngle;
-            unsigned char instance;
-            tN2kWindReference ref;
-            bool s = ParseN2kPGN130306(msg, instance, windSpeed, windAngle, ref);
-            String ws(msToKnots(windSpeed));
-            ws += "kts";
-            setVlabel(SCR_NAV, ws);
-            if(s && windAngle != N2kDoubleNA) {
-                setGauge(SCR_NAV, (int)RadToDeg(windAngle) + 180);
-                setMeter(SCR_ENV, WINDANGLE, RadToDeg(windAngle), "°");
-                record["angle"] = (int)RadToDeg(windAngle) + 180;
-            }
-            if(s && windSpeed != N2kDoubleNA) {
-                setMeter(SCR_ENV, WINDSP, msToKnots(windSpeed), "kts");
-                record["wind"] = dpf(msToKnots(windSpeed), 1);
-            }
-        } break;
-
-        case 129026: {
-            // COG/SOG
-            unsigned char instance;
-            tN2kHeadingReference ref;
-            double hdg;
-            double sog;
-            bool s = ParseN2kPGN129026(msg, instance, ref, hdg, sog);
-            if(s && sog != N2kDoubleNA) {
-                setMeter(SCR_NAV, SOG, msToKnots(sog), "kts");
-                record["sog"] = dpf(msToKnots(sog), 1);
-            }
-            if(s && hdg != N2kDoubleNA) {
-                setMeter(SCR_NAV, HDG, RadToDeg(hdg), "°");
-                record["cog"] = (int)RadToDeg(hdg);
-            }
-
- 
-
-        } break;
-
-        case 128267: {
-            // depth;
-            unsigned char instance;
-            double depth;
-            double offset;
-            double range;
-            bool s = ParseN2kPGN128267(msg, instance, depth, offset, range);
-            if(s && depth != N2kDoubleNA) {
-                setMeter(SCR_NAV, DEPTH, depth, "m");
-                record["depth"] = dpf(depth,1);
-            }
-        } break;
-
-        case 129029: {
-            // GNSS
-            unsigned char instance;
-            uint16_t DaysSince1970;
-            double SecondsSinceMidnight;
-            double Latitude;
-            double Longitude;
-            double Altitude;
-            tN2kGNSStype GNSStype;
-            tN2kGNSSmethod GNSSmethod;
-            unsigned char nSatellites;
-            double Hdop;
-            double PDOP;
-            double GeoidalSeparation;
-            unsigned char nReferenceStations;
-            tN2kGNSStype ReferenceStationType;
-            uint16_t ReferenceSationID;
-            double AgeOfCorrection;
-
-            bool s = ParseN2kPGN129029(msg, instance, DaysSince1970, SecondsSinceMidnight, Latitude,
-                                       Longitude, Altitude, GNSStype, GNSSmethod, nSatellites, Hdop, PDOP, GeoidalSeparation,
-                                       nReferenceStations, ReferenceStationType, ReferenceSationID, AgeOfCorrection);
-
-            // Convert seconds since midnight to HH:MM:SS
-            // Check we have valid values! 
-            if (s && DaysSince1970 !=  N2kUInt16NA && SecondsSinceMidnight != N2kDoubleNA) {
-                uint16_t seconds, minutes, hours;
-                uint32_t t = SecondsSinceMidnight;
-                seconds = t % 60;
-                t = (t - seconds) / 60;
-                minutes = t % 60;
-                hours = (t - minutes) / 60;
-                char buf[10];
-                snprintf(buf, 9, "%02d:%02d:%02d", hours, minutes, seconds);
-
-                setMeter(SCR_GNSS, HDOP, Hdop, "");
-
-                record["lat"] = Latitude;
-                record["lon"] = Longitude;
-                record["time"] = buf;
-                record["days"] = DaysSince1970;
-                record["seconds"] = SecondsSinceMidnight;
+    // A binary log captures every message on the bus, not just the decoded
+    // values. The ingest filter passes them all when it is on.
+    bool binaryLog = getLogFormat() == LOG_BINARY;
+    if (binaryLog) {
+        capture_log(msg);
+    }
 
-#define SECONDS_IN_DAY (60 * 60 * 24)
+    const PgnHandler *handler = findPgnHandler(msg.PGN);
+    if (!handler || !handler->decode) {
+        // Not a message we do anything with
+        return;
+    }
 
-                time_t now = (DaysSince1970 * SECONDS_IN_DAY) + SecondsSinceMidnight;
-                // now = 365 * 10 * SECONDS_IN_DAY;
-                // now += 26 * SECONDS_IN_DAY;
-                struct tm tm;
-                gmtime_r(&now, &tm);
-                /*
-                Serial.printf("XX %d %d %f %ld %d-%d-%d %d:%d:%d\n",
-                              DaysSince1970,
-                              SecondsSinceMidnight,
-                              now,
-                              tm.tm_hour, tm.tm_min, tm.tm_sec,
-                              tm.tm_mday, tm.tm_mon + 1, tm.tm_year + 1900);
-                */
-                // Update the system time
-                rtc.setTime(tm.tm_sec, tm.tm_min, tm.tm_hour, tm.tm_mday, tm.tm_mon + 1, tm.tm_year + 1900);
-            }
-        } break;
-
-        case 126992: {
-            // date and time
-            // Ignore this as we use the values in PGN129029
-        }  break;
-
-        case 129540: {
-            // GNSS satellites in view
-
-            unsigned char instance;
-            tN2kRangeResidualMode Mode;
-            uint8_t NumberOfSVs;
-
-            // First get the number of satellites in view
-            bool s = ParseN2kPGN129540(msg, instance, Mode, NumberOfSVs);
-
-            initGNSSSky(NumberOfSVs);
-            initGNSSSignal(NumberOfSVs);
-            // Now for each satellite index get the details
-            for (int i = 0; i < NumberOfSVs; i++) {
-                tSatelliteInfo SatelliteInfo;
-
-                s = ParseN2kPGN129540(msg, i, SatelliteInfo);
-/*                Console->printf("RET %d Sat %d PRN %d AZ %f EL %f SNR %f\n", s, i, SatelliteInfo.PRN,
-                                RadToDeg(SatelliteInfo.Azimuth), RadToDeg(SatelliteInfo.Elevation),
-                                SatelliteInfo.SNR);
-*/                                
-                setGNSSSignal(i, SatelliteInfo.SNR);
-                setGNSSSky(i, RadToDeg(SatelliteInfo.Azimuth), RadToDeg(SatelliteInfo.Elevation));
-                
-            }
-
-            setMeter(SCR_GNSS, SATS, (double)NumberOfSVs, "");
-
-        } break;
-
-        case 130310: {
-            // Outside Environmental
-            unsigned char instance;
-            double WaterTemperature;
-            double OutsideAmbientAirTemperature;
-            double AtmosphericPressure;
-
-            bool s = ParseN2kPGN130310(msg, instance, WaterTemperature, OutsideAmbientAirTemperature, AtmosphericPressure);
-
-            if(s && WaterTemperature > 273.0) {
-                setMeter(SCR_ENV, SEATEMP, KelvinToC(WaterTemperature), "°C");
-                record["seatemp"] = dpf(KelvinToC(WaterTemperature),1);
-            }
-        } break;
-
-        case 130312: {
-            // Temperature
-            unsigned char instance;
-            unsigned char TempInstance;
-            tN2kTempSource TempSource;
-            double ActualTemperature;
-            double SetTemperature;
-
-            bool s = ParseN2kPGN130312(msg, instance, TempInstance, TempSource, ActualTemperature, SetTemperature);
-
-            if(s && ActualTemperature != 0.01) {
-                setMeter(SCR_ENV, AIRTEMP, KelvinToC(ActualTemperature), "°C");
-                record["airtemp"] = dpf(KelvinToC(ActualTemperature),1);
-            }
-        } break;
-
-        case 130313: {
-            // Humidity
-            unsigned char instance;
-            unsigned char HumidityInstance;
-            tN2kHumiditySource HumiditySource;
-            double ActualHumidity;
-
-            bool s = ParseN2kPGN130313(msg, instance, HumidityInstance, HumiditySource, ActualHumidity);
-
-            if(s && ActualHumidity != N2kDoubleNA) {
-                setMeter(SCR_ENV, HUM, ActualHumidity, "%");
-            }
-        } break;
-
-        case 130314: {
-            // Pressure
-            unsigned char instance;
-            unsigned char PressureInstance;
-            tN2kPressureSource PressureSource;
-            double Pressure;
-
-            bool s = ParseN2kPGN130314(msg, instance, PressureInstance, PressureSource, Pressure);
-
-            if(s && Pressure != 0.01) {
-                setMeter(SCR_ENV, PRESSURE, Pressure / 100, "");
-                record["pressure"]  = (int)Pressure / 100;
-            }
-        } break;
-
-        default:
-            // Catch any messages we don't expect
-            // and indicate no data
-            hadData = false;
-            break;
+    if (loggingActive() && !binaryLog) {
+        // get the current system time and format with YYY-MM-DD HH:MM:SS
+        // this is the primary key for each log entry.
+        // It only needs formatting again when the second changes.
+        static time_t last = 0;
+        static char key[25];
+        time_t now = time(NULL);
+        if (now != last) {
+            struct tm tm;
+            gmtime_r(&now, &tm);
+            snprintf(key, sizeof(key), "%d-%d-%d %d:%d:%d",
+                     tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+                     tm.tm_hour, tm.tm_min, tm.tm_sec);
+            last = now;
+        }
+        record.begin(msg.PGN, millis(), key);
+    } else {
+        // Nothing to log to, so the values are not recorded
+        record.disable();
     }
 
+    handler->decode(msg, record);
+
     // If we had some data then log it
-    size_t size = record.size();
-    if(hadData && size > 0) {
-        String buffer;
-        serializeJson(doc, buffer);
-        append_log(buffer.c_str());
-        String now = rtc.getTime("%A, %B %d %Y %H:%M:%S");
+    if (record.fields() > 0) {
+        append_log(record.end());
     }
-}
\ No newline at end of file
+}
@@ -30,8 +30,29 @@ OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 // Input/Output stream
 extern Stream *Console;
 
+#include <LogRecord.h>
+
 // Main message handler
 void handlePGN(tN2kMsg &msg);
 
-// Time display update
-void updateTime();
+// Decodes a message, stores the values and fills in the log record
+typedef void (*PgnDecoder)(const tN2kMsg &msg, LogRecord &record);
+
+// An entry in the PGN registry
+typedef struct {
+    uint32_t pgn;
+    const char *name;    // Shown in the message listings
+    PgnDecoder decode;   // NULL if we don't handle the PGN
+} PgnHandler;
+
+// Find the registry entry for a PGN, NULL if there is none
+const PgnHandler *findPgnHandler(uint32_t pgn);
+
+// The whole registry. Returns the number of entries.
+size_t getPgnHandlers(const PgnHandler **list);
+
+// The name of a PGN for the message listings
+const char *pgnName(uint32_t pgn);
+
+// Time display update. Returns the ms to the next second.
+uint32_t updateTime();
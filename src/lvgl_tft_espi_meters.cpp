@@ -23,12 +23,17 @@ OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
 #include <GwPrefs.h>
-#include <StringStream.h>
+#include <BufStream.h>
 #include <SysInfo.h>
 #include <TFT_eSPI.h>
 #include <lvgl.h>
 //#include <rotary_encoder.h>
 #include <tftscreen.h>
+#include <VesselData.h>
+#include <NumFormat.h>
+#include <RollingStats.h>
+#include <SkyTrig.h>
+#include <GwSched.h>
 #include <NMEA2000.h>
 #include <N2kMessages.h>
 
@@ -54,11 +59,46 @@ OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 // ----------------------------
 
 SPIClass mySpi = SPIClass(HSPI);
-XPT2046_Touchscreen ts(XPT2046_CS, XPT2046_IRQ);
+
+// The pen interrupt is handled here rather than by the library, so the
+// library is told there is no IRQ pin and samples whenever asked.
+XPT2046_Touchscreen ts(XPT2046_CS, 255);
 
 TFT_eSPI tft = TFT_eSPI(); /* TFT instance */
 static lv_disp_buf_t disp_buf;
-static lv_color_t buf[TFT_WIDTH * 10];
+
+// Lines drawn per LVGL buffer. There are two buffers so that LVGL can render
+// into one while the other is sent to the display by DMA. Set DISP_BUF_LINES
+// in the build flags to trade RAM for fewer, larger transfers.
+#ifndef DISP_BUF_LINES
+#define DISP_BUF_LINES 10
+#endif
+
+// The display is used in landscape so a line is TFT_HEIGHT pixels
+#define DISP_BUF_SIZE (TFT_HEIGHT * DISP_BUF_LINES)
+static lv_color_t buf1[DISP_BUF_SIZE];
+static lv_color_t buf2[DISP_BUF_SIZE];
+
+// Display refresh timings
+static struct {
+    uint32_t frames;    // Refreshes reported by LVGL
+    uint32_t renderMs;  // Total time LVGL spent on them
+    uint64_t pixels;    // Total pixels redrawn
+    uint32_t flushes;   // Buffers sent to the display
+    uint64_t flushUs;   // Time in my_disp_flush, mostly waiting for the previous DMA
+    uint64_t waitUs;    // Time waiting for the last DMA after lv_task_handler
+    uint32_t handlerUs; // Longest lv_task_handler call including the final wait
+} flushStats;
+
+// Recent samples of the pipeline timings, for the gfx command. The handler
+// time and invalidated areas are kept per screen so the screens can be
+// compared. The window holds enough samples for the 99th percentile to
+// leave out the worst one.
+#define GFX_WINDOW 128
+static RollingStats<GFX_WINDOW> handlerTimes[SCR_MAX];  // us per lv_task_handler call that drew
+static RollingStats<GFX_WINDOW> invalidAreas[SCR_MAX];  // Areas invalidated per redraw
+static RollingStats<GFX_WINDOW> framePixels;            // Pixels redrawn per frame
+static RollingStats<GFX_WINDOW> flushTimes;             // us per call of my_disp_flush
 
 #if USE_LV_LOG != 0
 /* Serial debugging */
@@ -76,18 +116,40 @@ static lv_obj_t *createEnvScreen(int screen);
 static lv_obj_t *createInfoScreen(int screen);
 
 /* Display flushing */
+// Set while the flush holds the bus with startWrite, until metersWork ends it
+static bool tftWriting;
+
+// The buffer is sent by DMA and LVGL is told straight away that it is free,
+// so it can render the next stripe into the other buffer while this one is
+// sent. pushImageDMA waits for the previous transfer before starting, so a
+// buffer is never rewritten while it is still being sent.
 void my_disp_flush(lv_disp_drv_t *disp, const lv_area_t *area, lv_color_t *color_p) {
+    uint32_t start = micros();
     uint32_t w = (area->x2 - area->x1 + 1);
     uint32_t h = (area->y2 - area->y1 + 1);
 
-    tft.startWrite();
-    tft.setAddrWindow(area->x1, area->y1, w, h);
-    tft.pushColors(&color_p->full, w * h, true);
-    tft.endWrite();
+    // Hold the bus until lv_task_handler has finished, see metersWork
+    if (!tftWriting) {
+        tft.startWrite();
+        tftWriting = true;
+    }
+    tft.pushImageDMA(area->x1, area->y1, w, h, (uint16_t *)&color_p->full);
 
+    uint32_t took = micros() - start;
+    flushStats.flushes++;
+    flushStats.flushUs += took;
+    flushTimes.add(took);
     lv_disp_flush_ready(disp);
 }
 
+// Called by LVGL after each refresh with its time and the pixels redrawn
+static void my_disp_monitor(lv_disp_drv_t *disp, uint32_t time, uint32_t px) {
+    flushStats.frames++;
+    flushStats.renderMs += time;
+    flushStats.pixels += px;
+    framePixels.add(px);
+}
+
 #if 0
 /*
  * Read the input rotary encoder
@@ -128,14 +190,45 @@ static lv_obj_t *GNSSChart;
 // GNSSS sky view
 static lv_obj_t *skyView;
 
-// Static local cache of satellite data
-#define MAXSATS 9
+// Pool of satellite markers. A satellite keeps its slot, and so its bar in
+// the chart, for as long as it stays in view. Dots for satellites that drop
+// out of view are hidden and reused rather than deleted.
+#define MAXSATS 64
+#define NO_SLOT 0xFF
+
+// Receivers split the satellites in view over several messages, so one
+// is only taken out of view when none of them has reported it for this many ms
+#define GNSS_EXPIRE 2000
 
 struct SatData {
     lv_obj_t *dot;
+    int16_t x, y;   // Position the dot was last moved to
+    uint8_t prn;
+    bool used;      // Slot belongs to a satellite in view
+    uint32_t seen;  // millis() when it was last reported
 };
 
 static SatData satData[MAXSATS];
+static uint8_t prnSlot[256];    // Slot for each PRN or NO_SLOT
+static lv_coord_t satSnr[MAXSATS];  // Signal bar for each slot, copied in by applyChart
+static uint32_t chartPoints;    // Points in the signal chart series
+
+// Chart changes are held during an update and refreshed once at the end
+static bool gnssBatch;          // Between beginGNSSUpdate and commitGNSSUpdate
+static bool chartDirty;         // The chart has changed since its last refresh
+
+// Chart refreshes made, and those saved by batching or unchanged values
+static uint32_t chartRefreshes, chartRefreshesSaved;
+
+// Sky view geometry, fixed once the screen is created
+static struct {
+    int32_t radius;     // Distance of a dot on the horizon from the centre
+    int32_t xorig;      // Dot position for the zenith
+    int32_t yorig;
+} skyGeom;
+
+// Dot moves made and skipped because the dot was already there
+static uint32_t skyMoves, skyMovesSkipped;
 
 // Print some text to the boot info screen textarea
 void displayText(const char *str) {
@@ -162,21 +255,119 @@ void printTouchToSerial(TS_Point p) {
 
 /*
  * Read the touch panel
+ *
+ * The panel is only sampled while a press is in progress. A press is started
+ * by the pen interrupt and ends when the pressure drops away and the pen
+ * interrupt line has gone high again. Samples are passed through a median
+ * of three, to drop single noisy readings, and then a simple IIR filter to
+ * steady the point.
  */
 
+// Pressure below which the pen is taken as lifted
+#define TOUCH_Z_MIN 400
+
+// IIR filter weight of a new sample, as a shift. 1 gives half old, half new.
+#define TOUCH_IIR_SHIFT 1
+
+static volatile bool touchIrq;  // Set by the pen interrupt
+static volatile bool touchActive;  // A press is in progress
+static int16_t touchX[3], touchY[3];
+static uint8_t touchN;          // Next entry in the median history
+static int32_t filtX, filtY;    // Filtered point
+
+// Touch presses, samples read and pen interrupts that did not lead to a press
+static uint32_t touchPresses, touchSamples, touchSpurious;
+// Samples in a press whose pressure dipped while the pen stayed down
+static uint32_t touchDips;
+
+static void IRAM_ATTR touchISR() {
+    if (!touchActive) {
+        touchIrq = true;
+        schedWakeFromISR(metersWork);
+    }
+}
+
+static int16_t median3(const int16_t *v) {
+    int16_t a = v[0], b = v[1], c = v[2];
+    if (a > b) {
+        int16_t t = a;
+        a = b;
+        b = t;
+    }
+    return c < a ? a : (c > b ? b : c);
+}
+
 bool read_touch(lv_indev_drv_t *indev, lv_indev_data_t *data) {
-    if (ts.tirqTouched() && ts.touched()) {
-        TS_Point p = ts.getPoint();
-        //    printTouchToSerial(p);
-        data->point.x = p.x / MAX_TOUCH_X;
-        data->point.y = p.y / MAX_TOUCH_Y;
-        data->state = LV_INDEV_STATE_PR or LV_INDEV_STATE_REL;
+    if (!touchActive) {
+        // Nothing to do on the bus until the pen goes down
+        if (!touchIrq) {
+            data->point.x = filtX;
+            data->point.y = filtY;
+            data->state = LV_INDEV_STATE_REL;
+            return false;
+        }
+        touchIrq = false;
+        touchN = 0;
+    }
+
+    TS_Point p = ts.getPoint();
+    touchSamples++;
+    if (p.z < TOUCH_Z_MIN) {
+        // The interrupt line is low while the pen is down, even when the
+        // pressure is too light to read. No new falling edge will come
+        // then, so keep sampling instead of waiting for one.
+        bool penDown = digitalRead(XPT2046_IRQ) == LOW;
+        if (touchActive && penDown) {
+            // A short dip in pressure, hold the press
+            touchDips++;
+            data->point.x = filtX;
+            data->point.y = filtY;
+            data->state = LV_INDEV_STATE_PR;
+            return false;
+        }
+        // The pen has been lifted, or the interrupt was noise
+        if (touchActive) {
+            touchActive = false;
+        } else if (!penDown) {
+            touchSpurious++;
+        }
+        touchIrq = penDown;   // Ignore interrupts caused by sampling
+        data->point.x = filtX;
+        data->point.y = filtY;
+        data->state = LV_INDEV_STATE_REL;
+        return false;
     }
+
+    int16_t x = p.x / MAX_TOUCH_X;
+    int16_t y = p.y / MAX_TOUCH_Y;
+    if (!touchActive) {
+        // Start of a press, fill the history so the filters start here
+        touchActive = true;
+        touchPresses++;
+        for (int i = 0; i < 3; i++) {
+            touchX[i] = x;
+            touchY[i] = y;
+        }
+        filtX = x;
+        filtY = y;
+    } else {
+        touchX[touchN] = x;
+        touchY[touchN] = y;
+        touchN = (touchN + 1) % 3;
+        filtX += (median3(touchX) - filtX) >> TOUCH_IIR_SHIFT;
+        filtY += (median3(touchY) - filtY) >> TOUCH_IIR_SHIFT;
+    }
+    //    printTouchToSerial(p);
+    data->point.x = filtX;
+    data->point.y = filtY;
+    data->state = LV_INDEV_STATE_PR;
     return false;
 }
 
 static int iiscrnum = 0;  // Screen number selected
 
+static void showScreen(int scr);
+
 // Handle the touch event.
 static void my_event_cb(lv_obj_t *obj, lv_event_t event) {
     //   Serial.printf("EV %d\n", event);
@@ -187,22 +378,29 @@ static void my_event_cb(lv_obj_t *obj, lv_event_t event) {
             // Ignore the boot messages screen during normal operation
             iiscrnum++;
         }
-        lv_scr_load(screen[iiscrnum]);
-        StringStream s;
-        getSysInfo(s);
-        lv_textarea_set_text(textAreas[SCR_SYSINFO], s.data.c_str());
-        s.clear();
-        getN2kMsgs(s);
-        lv_textarea_set_text(textAreas[SCR_MSGS], s.data.c_str());
-        s.clear();
-        getNetInfo(s);
-        lv_textarea_set_text(textAreas[SCR_NETWORK], s.data.c_str());
+        showScreen(iiscrnum);
 
         String val(iiscrnum);
         GwSetVal(GWSCREEN, val);
     }
 }
 
+// Set a label's text only if it differs from what is already shown.
+// lv_label_set_text reallocates the text and invalidates the label area
+// even when the text is the same, so the label's own copy is compared first.
+// Returns true if the label was changed.
+static bool setLabelText(lv_obj_t *label, const char *value) {
+    const char *shown = lv_label_get_text(label);
+    if (shown && strcmp(shown, value) == 0) {
+        return false;
+    }
+    lv_label_set_text(label, value);
+    return true;
+}
+
+// Value label updates that were drawn and that were skipped as unchanged
+static uint32_t labelUpdates, labelSkipped;
+
 // Constructor. Binds to the parent object.
 Indicator::Indicator(lv_obj_t *parent, const char *name, uint32_t x, uint32_t y) {
     container = lv_cont_create(parent, NULL);
@@ -226,8 +424,16 @@ Indicator::Indicator(lv_obj_t *parent, const char *name, uint32_t x, uint32_t y)
     lv_obj_set_pos(container, x, y);
 }
 
+// Text updates that were drawn and that were skipped as unchanged
+uint32_t Indicator::updates;
+uint32_t Indicator::skipped;
+
 void Indicator::setValue(const char *value) {
-    lv_label_set_text(text, value);
+    if (setLabelText(text, value)) {
+        updates++;
+    } else {
+        skipped++;
+    }
 }
 
 void touch_init() {
@@ -236,6 +442,10 @@ void touch_init() {
     bool s = ts.begin(mySpi);
     Serial.printf("Touch begin => %d\n", s);
     ts.setRotation(1);
+
+    // The pen interrupt goes low when the panel is pressed
+    pinMode(XPT2046_IRQ, INPUT);
+    attachInterrupt(digitalPinToInterrupt(XPT2046_IRQ), touchISR, FALLING);
 }
 
 void metersSetup() {
@@ -252,8 +462,14 @@ void metersSetup() {
     // Clear the screen
     // tft.fillRect(0, 0, TFT_WIDTH, TFT_HEIGHT, 0);
     tft.setRotation(1); /* Landscape orientation */
+    tft.initDMA();
+#if LV_COLOR_16_SWAP
+    tft.setSwapBytes(false);
+#else
+    tft.setSwapBytes(true);
+#endif
 
-    lv_disp_buf_init(&disp_buf, buf, NULL, TFT_WIDTH * 10);
+    lv_disp_buf_init(&disp_buf, buf1, buf2, DISP_BUF_SIZE);
 
     /*Initialize the display*/
     lv_disp_drv_t disp_drv;
@@ -261,6 +477,7 @@ void metersSetup() {
     disp_drv.hor_res = TFT_HEIGHT;
     disp_drv.ver_res = TFT_WIDTH;
     disp_drv.flush_cb = my_disp_flush;
+    disp_drv.monitor_cb = my_disp_monitor;
     disp_drv.buffer = &disp_buf;
     lv_disp_drv_register(&disp_drv);
 
@@ -476,6 +693,14 @@ static lv_obj_t *createGNSSScreen(int scr) {
     skyView = lv_img_create(cont, NULL);
     lv_img_set_src(skyView, &sky);
     lv_obj_align(skyView, NULL, LV_ALIGN_IN_TOP_RIGHT, 0, 0);
+
+    // The sky and dot images never change size so work out where dots go once
+    LV_IMG_DECLARE(green_dot);
+    int32_t skyw = lv_obj_get_width(skyView);
+    int32_t skyh = lv_obj_get_height(skyView);
+    skyGeom.radius = skyw / 2 - green_dot.header.w;
+    skyGeom.xorig = skyw / 2 - green_dot.header.w / 2;
+    skyGeom.yorig = skyh / 2 - green_dot.header.h / 2;
     lv_obj_set_style_local_margin_top(skyView, LV_IMG_PART_MAIN, LV_STATE_DEFAULT, 0);
 
     // Chart for the signal strength
@@ -491,9 +716,11 @@ static lv_obj_t *createGNSSScreen(int scr) {
     GNSSChartSeries = lv_chart_add_series(GNSSChart, LV_COLOR_GREEN);
 
     // Zero all the values at the start
-    for (int i = 0; i < MAXSATS; i++) {
+    chartPoints = lv_chart_get_point_count(GNSSChart);
+    for (uint32_t i = 0; i < chartPoints; i++) {
         GNSSChartSeries->points[i] = 0;
     }
+    memset(prnSlot, NO_SLOT, sizeof(prnSlot));
 
     // Event callback
     lv_obj_set_event_cb(ind[scr][0]->container, my_event_cb); /*Assign an event callback*/
@@ -502,15 +729,14 @@ static lv_obj_t *createGNSSScreen(int scr) {
 
 #if GNSSTEST
     // Test data
-    for (int i = 0; i < 9; i++) {
-        setGNSSSignal(i, random(40, 50));
-    }
-
     // Creates a spiral from the top clockwise to the centre
     uint32_t points = 64;
+    beginGNSSUpdate();
     for (int i = 0; i < points; i++) {
-        setGNSSSky(i, i * 360 / points, i * 90 / points);
+        setGNSSSignal(i + 1, random(40, 50));
+        setGNSSSky(i + 1, i * 360 / points, i * 90 / points);
     }
+    commitGNSSUpdate();
 #endif
     return screen;
 }
@@ -557,19 +783,64 @@ static lv_obj_t *createInfoScreen(int scr) {
     return screen;
 }
 
+// How often to run the lvgl tasks. Well inside the lvgl refresh
+// and input read periods.
+#define METERS_PERIOD 10
+
 // Update the meters. Called regularly from the main loop/task
-void metersWork(void) {
+uint32_t metersWork(void) {
+    lv_disp_t *disp = lv_disp_get_default();
+    uint32_t invalid = disp ? disp->inv_p : 0;
+    uint32_t frames = flushStats.frames;
+    uint32_t start = micros();
     lv_task_handler(); /* let the GUI do its work */
+
+    // Let the last transfer finish and release the bus
+    if (tftWriting) {
+        uint32_t wait = micros();
+        tft.dmaWait();
+        tft.endWrite();
+        tftWriting = false;
+        flushStats.waitUs += micros() - wait;
+    }
+    uint32_t took = micros() - start;
+    if (took > flushStats.handlerUs) {
+        flushStats.handlerUs = took;
+    }
+    // Most calls have nothing to draw, only those that did are of interest
+    if (flushStats.frames != frames) {
+        handlerTimes[iiscrnum].add(took);
+        invalidAreas[iiscrnum].add(invalid);
+    }
+    return METERS_PERIOD;
+}
+
+// Text set for the meters and info labels of screens that are not showing.
+// It is held here rather than drawn and showScreen applies it when the
+// screen is loaded. An empty string is nothing pending.
+#define PENDING_LEN 24
+static char pendingMeter[SCR_MAX][6][PENDING_LEN];
+static char pendingInfo[SCR_MAX][PENDING_LEN];
+static uint32_t pendingHeld, pendingApplied;
+
+static void meterText(int scr, int idx, const char *str) {
+    if (scr >= 0 && scr < SCR_MAX && ind[scr][idx]) {
+        if (scr != iiscrnum) {
+            strlcpy(pendingMeter[scr][idx], str, PENDING_LEN);
+            pendingHeld++;
+            return;
+        }
+        pendingMeter[scr][idx][0] = '\0';
+        ind[scr][idx]->setValue(str);
+    }
 }
 
 // Set the value of a meter using a double
 void setMeter(int scr, int idx, double value, const char *units) {
     //    Serial.printf("SET %d %d %f\n", scr, idx, value);
-    if (scr >= 0 && scr < SCR_MAX && ind[scr][idx]) {
-        String v(value, 2);
-        v += units;
-        ind[scr][idx]->setValue(v.c_str());
-    }
+    char text[24];
+    fmtValue(text, sizeof(text), value, 2, 0, units);
+    meterText(scr, idx, text);
 }
 
 void setGauge(int scr, double value) {
@@ -580,30 +851,353 @@ void setGauge(int scr, double value) {
 
 // Set the value of a meter using a string
 void setMeter(int scr, int idx, String &string) {
-    if (scr >= 0 && scr < SCR_MAX && ind[scr][idx]) {
-        ind[scr][idx]->setValue(string.c_str());
-    }
+    meterText(scr, idx, string.c_str());
 }
 
 // set using a char *
 void setMeter(int scr, int idx, char * str) {
-    if (scr >= 0 && scr < SCR_MAX && ind[scr][idx]) {
-        ind[scr][idx]->setValue(str);
-    }
+    meterText(scr, idx, str);
 }
 
 void setVlabel(int scr, String &str) {
+    setVlabel(scr, str.c_str());
+}
+
+void setVlabel(int scr, const char *str) {
     if (scr >= 0 && scr < SCR_MAX && vals[scr]) {
-        lv_label_set_text(vals[scr], str.c_str());
+        if (setLabelText(vals[scr], str)) {
+            labelUpdates++;
+        } else {
+            labelSkipped++;
+        }
     }
 }
 
 void setilabel(int scr, String &str) {
     if (scr >= 0 && scr < SCR_MAX && infos[scr]) {
-        lv_label_set_text(infos[scr], str.c_str());
+        if (scr != iiscrnum) {
+            strlcpy(pendingInfo[scr], str.c_str(), PENDING_LEN);
+            pendingHeld++;
+            return;
+        }
+        pendingInfo[scr][0] = '\0';
+        if (setLabelText(infos[scr], str.c_str())) {
+            labelUpdates++;
+        } else {
+            labelSkipped++;
+        }
     }
 }
 
+// How the vessel data channels are shown
+typedef enum {
+    SHOW_METER,   // An indicator panel
+    SHOW_GAUGE,   // The screen's gauge needle
+    SHOW_VLABEL   // The value label under the gauge
+} ShowAs;
+
+typedef struct {
+    Channel ch;
+    ShowAs as;
+    uint8_t scr;
+    uint8_t idx;        // Indicator index for a meter
+    float scale;        // Applied to the stored value before it is shown
+    float offset;
+    uint8_t dp;         // Decimal places shown
+    uint8_t width;      // Characters the number is padded to
+    const char *units;
+    uint16_t interval;  // Minimum ms between redraws
+    float deadband;     // Smallest change, after scaling, worth a redraw
+} ChannelView;
+
+// Values arrive at up to 10Hz, far faster than they can be read. Each view
+// is redrawn at most once per interval with the latest value, and only when
+// it has moved by more than the deadband.
+static const ChannelView views[] = {
+    // Channel     Shown as     Screen      Index      Scale  Offset dp w  Units  ms    Deadband
+    {CH_HOUSEV,    SHOW_METER,  SCR_ENGINE, HOUSEV,    1,     0,     2, 5, "V",   1000, 0.01},
+    {CH_HOUSEI,    SHOW_METER,  SCR_ENGINE, HOUSEI,    1,     0,     1, 5, "A",   500,  0.1},
+    {CH_ENGINEV,   SHOW_METER,  SCR_ENGINE, ENGINEV,   1,     0,     2, 5, "V",   1000, 0.01},
+    {CH_RPM,       SHOW_GAUGE,  SCR_ENGINE, 0,         0.01,  0,     0, 0, "",    250,  1},
+    {CH_RPM,       SHOW_VLABEL, SCR_ENGINE, 0,         1,     0,     0, 4, "rpm", 500,  10},
+    {CH_SOG,       SHOW_METER,  SCR_NAV,    SOG,       1,     0,     1, 4, "kts", 500,  0.1},
+    {CH_DEPTH,     SHOW_METER,  SCR_NAV,    DEPTH,     1,     0,     1, 5, "m",   500,  0.1},
+    {CH_COG,       SHOW_METER,  SCR_NAV,    HDG,       1,     0,     0, 3, "°",   500,  1},
+    {CH_WINDANGLE, SHOW_GAUGE,  SCR_NAV,    0,         1,     180,   0, 0, "",    250,  1},
+    {CH_WINDSPEED, SHOW_VLABEL, SCR_NAV,    0,         1,     0,     1, 4, "kts", 500,  0.1},
+    {CH_SATS,      SHOW_METER,  SCR_GNSS,   SATS,      1,     0,     0, 2, "",    1000, 1},
+    {CH_HDOP,      SHOW_METER,  SCR_GNSS,   HDOP,      1,     0,     1, 4, "",    1000, 0.1},
+    {CH_AIRTEMP,   SHOW_METER,  SCR_ENV,    AIRTEMP,   1,     0,     1, 5, "°C",  2000, 0.1},
+    {CH_HUMIDITY,  SHOW_METER,  SCR_ENV,    HUM,       1,     0,     0, 3, "%",   2000, 1},
+    {CH_PRESSURE,  SHOW_METER,  SCR_ENV,    PRESSURE,  1,     0,     0, 4, "",    2000, 1},
+    {CH_SEATEMP,   SHOW_METER,  SCR_ENV,    SEATEMP,   1,     0,     1, 4, "°C",  2000, 0.1},
+    {CH_WINDSPEED, SHOW_METER,  SCR_ENV,    WINDSP,    1,     0,     1, 4, "kts", 500,  0.1},
+    {CH_WINDANGLE, SHOW_METER,  SCR_ENV,    WINDANGLE, 1,     0,     0, 4, "°",   500,  1},
+};
+
+#define NUM_VIEWS (sizeof(views) / sizeof(views[0]))
+
+// What each view last showed, and how many store updates it did not draw
+typedef struct {
+    uint32_t seq;           // Store sequence number of the value shown
+    uint32_t time;          // When it was drawn
+    float value;            // The scaled value drawn
+    bool drawn;             // A value has been drawn
+    bool stale;             // "---" is showing
+    uint32_t redraws;
+    uint32_t coalesced;     // Updates replaced by a later one before their turn
+    uint32_t deadbanded;    // Updates too small to redraw
+} ViewState;
+
+static ViewState viewState[NUM_VIEWS];
+
+// How often the views are checked for values that are due
+#define DISPLAY_PERIOD 50
+
+static void showValue(const ChannelView &v, float value) {
+    char text[24];
+    switch (v.as) {
+        case SHOW_METER:
+            fmtValue(text, sizeof(text), value, v.dp, v.width, v.units);
+            setMeter(v.scr, v.idx, text);
+            break;
+        case SHOW_GAUGE:
+            setGauge(v.scr, (int)value);
+            break;
+        case SHOW_VLABEL:
+            fmtValue(text, sizeof(text), value, v.dp, v.width, v.units);
+            setVlabel(v.scr, text);
+            break;
+    }
+}
+
+// Values that stop arriving are blanked rather than left looking current
+static void showStale(const ChannelView &v) {
+    static char dashes[] = "---";
+    switch (v.as) {
+        case SHOW_METER:
+            setMeter(v.scr, v.idx, dashes);
+            break;
+        case SHOW_GAUGE:
+            break;
+        case SHOW_VLABEL:
+            setVlabel(v.scr, dashes);
+            break;
+    }
+}
+
+// The info screens are filled in by a provider, only while they are showing
+typedef void (*InfoProvider)(Stream &s);
+
+static const struct {
+    uint8_t scr;
+    InfoProvider fill;
+} infoProviders[] = {
+    {SCR_NETWORK, getNetInfo},
+    {SCR_SYSINFO, getSysInfo},
+    {SCR_MSGS, getN2kMsgs},
+};
+
+// How often a showing info screen is refreshed
+#define INFO_PERIOD 2000
+
+// Text for the info screens. Only one shows at a time so they share it.
+#define INFO_BUF_SIZE 4096
+static char infoBuf[INFO_BUF_SIZE];
+static uint32_t infoTime;           // When the showing info screen was last filled
+static uint32_t infoFills, infoUnchanged;
+
+// Fill in an info screen if it has a provider
+static void refreshInfo(int scr) {
+    for (size_t i = 0; i < sizeof(infoProviders) / sizeof(infoProviders[0]); i++) {
+        if (infoProviders[i].scr == scr && textAreas[scr]) {
+            BufStream s(infoBuf, sizeof(infoBuf));
+            infoProviders[i].fill(s);
+            if (strcmp(lv_textarea_get_text(textAreas[scr]), s.c_str()) == 0) {
+                infoUnchanged++;
+            } else {
+                lv_textarea_set_text(textAreas[scr], s.c_str());
+                infoFills++;
+            }
+            infoTime = millis();
+            return;
+        }
+    }
+}
+
+// How often the satellites in view are redrawn while the GNSS screen shows
+#define GNSS_PERIOD 1000
+
+static uint32_t gnssTime;   // When the satellites were last redrawn
+
+// Redraw the satellites reported since the last redraw. Any not reported
+// for GNSS_EXPIRE ms are taken out of view by the commit.
+static void showSatellites(uint32_t now, bool loading) {
+    if (!loading && now - gnssTime < GNSS_PERIOD) {
+        return;
+    }
+    const SatSlot *sats = vdSats();
+    beginGNSSUpdate();
+    for (int i = 0; i < VD_MAXSATS; i++) {
+        const SatSlot &sat = sats[i];
+        if (sat.prn && (int32_t)(sat.time - gnssTime) >= 0 && now - sat.time <= GNSS_EXPIRE) {
+            // The SNR is N2kDoubleNA when the satellite did not report one,
+            // so show no bar rather than convert a negative float to unsigned
+            setGNSSSignal(sat.prn, sat.snr > 0 && sat.snr < 100 ? (uint32_t)sat.snr : 0);
+            setGNSSSky(sat.prn, sat.azimuth, sat.elevation);
+        }
+    }
+    commitGNSSUpdate();
+    gnssTime = now;
+}
+
+// Set while the views of a newly loaded screen are brought up to date
+static int loadedScreen = -1;
+
+// Count of screen loads and the views they brought up to date
+static uint32_t screenLoads, loadUpdates;
+
+// Copy new values from the vessel data store to the active screen, at no
+// more than each view's rate. Views on hidden screens are left alone and
+// their latest values wait in the store until the screen is loaded.
+uint32_t displayWork(void) {
+    uint32_t now = millis();
+    if (now - infoTime >= INFO_PERIOD) {
+        refreshInfo(iiscrnum);
+    }
+    for (size_t i = 0; i < NUM_VIEWS; i++) {
+        const ChannelView &v = views[i];
+        if (v.scr != iiscrnum) {
+            continue;
+        }
+        ViewState &state = viewState[i];
+        const ChannelSlot &slot = vdGet(v.ch);
+        bool loading = v.scr == loadedScreen;
+        if (slot.seq != state.seq) {
+            if (state.drawn && !loading && now - state.time < v.interval) {
+                continue;   // Not due yet, the latest value waits in the store
+            }
+            state.coalesced += slot.seq - state.seq - 1;
+            state.seq = slot.seq;
+            float value = slot.value * v.scale + v.offset;
+            if (state.drawn && !state.stale && fabsf(value - state.value) < v.deadband) {
+                state.deadbanded++;
+                continue;
+            }
+            showValue(v, value);
+            state.value = value;
+            state.time = now;
+            state.drawn = true;
+            state.stale = false;
+            state.redraws++;
+            if (loading) {
+                loadUpdates++;
+            }
+        } else if (state.drawn && !state.stale && vdStale(v.ch)) {
+            state.stale = true;
+            showStale(v);
+        }
+    }
+    if (iiscrnum == SCR_GNSS) {
+        showSatellites(now, loadedScreen == SCR_GNSS);
+    }
+    return DISPLAY_PERIOD;
+}
+
+// Draw the text held for a screen while it was not showing
+static void applyPending(int scr) {
+    for (int i = 0; i < 6; i++) {
+        if (pendingMeter[scr][i][0] && ind[scr][i]) {
+            ind[scr][i]->setValue(pendingMeter[scr][i]);
+            pendingMeter[scr][i][0] = '\0';
+            pendingApplied++;
+        }
+    }
+    if (pendingInfo[scr][0] && infos[scr]) {
+        if (setLabelText(infos[scr], pendingInfo[scr])) {
+            labelUpdates++;
+        } else {
+            labelSkipped++;
+        }
+        pendingInfo[scr][0] = '\0';
+        pendingApplied++;
+    }
+}
+
+// Load a screen and bring its views up to date in one batch before it is
+// next drawn. Held text goes first so newer values from the store win.
+static void showScreen(int scr) {
+    lv_scr_load(screen[scr]);
+    screenLoads++;
+    loadedScreen = scr;
+    applyPending(scr);
+    refreshInfo(scr);
+    displayWork();
+    loadedScreen = -1;
+}
+
+static void printSummary(Stream &s, const char *name, int scr, const RollingStats<GFX_WINDOW> &stats) {
+    RollingSummary sum = stats.summary();
+    if (!sum.count) {
+        return;
+    }
+    if (scr < 0) {
+        s.printf("%-10s %-6s", name, "all");
+    } else {
+        s.printf("%-10s %-6d", name, scr);
+    }
+    s.printf(" %4u %8u %8u %8u %8u\n", (unsigned)sum.count, sum.min, sum.mean, sum.p99, sum.max);
+}
+
+// Show the recent timings of the LVGL pipeline
+void getGfxStats(Stream &s) {
+    s.printf("Last %d samples of each\n", GFX_WINDOW);
+    s.printf("%-10s %-6s %4s %8s %8s %8s %8s\n", "Measure", "Screen", "N", "Min", "Mean", "P99", "Max");
+    for (int scr = 0; scr < SCR_MAX; scr++) {
+        printSummary(s, "Handler us", scr, handlerTimes[scr]);
+    }
+    for (int scr = 0; scr < SCR_MAX; scr++) {
+        printSummary(s, "Inv areas", scr, invalidAreas[scr]);
+    }
+    printSummary(s, "Pixels", -1, framePixels);
+    printSummary(s, "Flush us", -1, flushTimes);
+}
+
+// Show how many value updates the display drew and how many it saved
+void getDisplayStats(Stream &s) {
+    uint32_t redraws = 0, coalesced = 0, deadbanded = 0;
+    s.printf("%-12s %-6s %8s %9s %10s\n", "Channel", "Screen", "Redraws", "Coalesced", "Deadbanded");
+    for (size_t i = 0; i < NUM_VIEWS; i++) {
+        const ViewState &state = viewState[i];
+        s.printf("%-12s %-6d %8u %9u %10u\n", vdName(views[i].ch), views[i].scr,
+                 state.redraws, state.coalesced, state.deadbanded);
+        redraws += state.redraws;
+        coalesced += state.coalesced;
+        deadbanded += state.deadbanded;
+    }
+    s.printf("%-12s %-6s %8u %9u %10u\n", "Total", "", redraws, coalesced, deadbanded);
+    s.printf("Meter text  %u set, %u unchanged\n", Indicator::updates, Indicator::skipped);
+    s.printf("Label text  %u set, %u unchanged\n", labelUpdates, labelSkipped);
+    s.printf("Screen load %u loads, %u views brought up to date\n", screenLoads, loadUpdates);
+    s.printf("Held text   %u held for hidden screens, %u drawn on load\n", pendingHeld, pendingApplied);
+    s.printf("Sky dots    %u moved, %u already in place\n", skyMoves, skyMovesSkipped);
+    s.printf("GNSS chart  %u refreshes, %u saved\n", chartRefreshes, chartRefreshesSaved);
+    s.printf("Info screen %u filled, %u unchanged\n", infoFills, infoUnchanged);
+    s.printf("Touch       %u presses, %u samples, %u spurious interrupts, %u pressure dips\n", touchPresses,
+             touchSamples, touchSpurious, touchDips);
+
+    uint32_t secs = millis() / 1000;
+    uint32_t frames = flushStats.frames ? flushStats.frames : 1;
+    uint32_t flushes = flushStats.flushes ? flushStats.flushes : 1;
+    s.printf("Frames      %u, %u.%02u fps, %u ms render, %u px per frame\n", flushStats.frames,
+             secs ? flushStats.frames / secs : 0, secs ? flushStats.frames * 100 / secs % 100 : 0,
+             flushStats.renderMs / frames, (uint32_t)(flushStats.pixels / frames));
+    s.printf("Flush       %u buffers of %u lines, %u us per flush, %u us DMA wait per frame\n",
+             flushStats.flushes, DISP_BUF_LINES, (uint32_t)(flushStats.flushUs / flushes),
+             (uint32_t)(flushStats.waitUs / frames));
+    s.printf("Handler     %u us longest lv_task_handler\n", flushStats.handlerUs);
+}
+
 // Load the first screen
 void loadScreen() {
     // Get the last screen number if set and use that
@@ -611,65 +1205,145 @@ void loadScreen() {
     if (scrnum != "---") {
         iiscrnum = scrnum.toInt() % SCR_MAX;
     }
-    lv_scr_load(screen[iiscrnum]);
+    showScreen(iiscrnum);
 }
 
-// set a value in the GNSSChart
-void setGNSSSignal(uint32_t idx, uint32_t val) {
-    if (idx < 0 || idx > MAXSATS)
-        return;  // Ignore bad index
+// Find the slot for a satellite, taking a free one if it is new.
+// Returns NO_SLOT if the pool is full.
+static uint8_t satSlot(uint8_t prn) {
+    uint8_t slot = prnSlot[prn];
+    if (slot == NO_SLOT) {
+        for (slot = 0; slot < MAXSATS && satData[slot].used; slot++) {
+        }
+        if (slot == MAXSATS) {
+            return NO_SLOT;
+        }
+        satData[slot].used = true;
+        satData[slot].prn = prn;
+        prnSlot[prn] = slot;
+        // A reused dot stays hidden until setGNSSSky places it, so the
+        // last satellite's position is never shown for this one
+        satData[slot].x = -1;
+        satData[slot].y = -1;
+    }
+    satData[slot].seen = millis();
+    return slot;
+}
 
-    GNSSChartSeries->points[idx] = val;
-    lv_chart_refresh(GNSSChart);
+// Bring the chart up to date with the signal bars. It is resized to the
+// highest slot in use first. A resize refreshes the chart itself, so it
+// takes the place of the refresh rather than adding another.
+static void applyChart() {
+    uint32_t points = 1;
+    for (int i = 0; i < MAXSATS; i++) {
+        if (satData[i].used) {
+            points = i + 1;
+        }
+    }
+    bool resized = points != chartPoints;
+    if (resized) {
+        chartPoints = points;
+        lv_chart_set_point_count(GNSSChart, chartPoints);
+    } else if (!chartDirty) {
+        return;
+    }
+    chartDirty = false;
+    for (uint32_t i = 0; i < chartPoints; i++) {
+        GNSSChartSeries->points[i] = satSnr[i];
+    }
+    if (!resized) {
+        lv_chart_refresh(GNSSChart);
+    }
+    chartRefreshes++;
 }
 
-// set one of the indicators in the sjky view
-void setGNSSSky(uint32_t idx, double azimuth, double declination) {
-    if (idx < 0 || idx > MAXSATS)
-        return;  // Ignore bad index
+// Note a chart change. Outside an update the chart is refreshed straight
+// away, inside one the refresh waits for commitGNSSUpdate.
+static void chartChanged() {
+    if (chartDirty) {
+        chartRefreshesSaved++;
+    }
+    chartDirty = true;
+    if (!gnssBatch) {
+        applyChart();
+    }
+}
+
+// Start an update of the satellites in view
+void beginGNSSUpdate() {
+    gnssBatch = true;
+    chartDirty = false;
+}
+
+// Set the signal strength bar for a satellite
+void setGNSSSignal(uint8_t prn, uint32_t val) {
+    uint8_t slot = satSlot(prn);
+    if (slot == NO_SLOT) {
+        return;
+    }
+    if (satSnr[slot] == (lv_coord_t)val) {
+        chartRefreshesSaved++;
+        return;
+    }
+    satSnr[slot] = val;
+    chartChanged();
+}
+
+// Show a satellite in the sky view using its azimuth and declination
+void setGNSSSky(uint8_t prn, double azimuth, double declination) {
     if (azimuth < 0 || azimuth > 360 || declination < 0 || declination > 90) {
         return;  // Ignore inplausible values
     }
+    uint8_t idx = satSlot(prn);
+    if (idx == NO_SLOT) {
+        return;
+    }
 
     // Green dot for the sky view
     if (!satData[idx].dot) {
-        // First time for this index so create the image object
+        // First time for this slot so create the image object
         LV_IMG_DECLARE(green_dot);
         satData[idx].dot = lv_img_create(skyView, NULL);
         lv_img_set_src(satData[idx].dot, &green_dot);
+        satData[idx].x = -1;    // Not placed yet
     }
-    uint32_t dotw, doth;
-    dotw = lv_obj_get_width(satData[idx].dot);
-    doth = lv_obj_get_height(satData[idx].dot);
-    uint32_t skyw, skyh;
-    skyw = lv_obj_get_width(skyView);
-    skyh = lv_obj_get_height(skyView);
-    double rad = skyw / 2 - dotw;
-    rad *= cos(DegToRad(declination));
-    int32_t x = sin(DegToRad(azimuth)) * rad;
-    int32_t y = cos(DegToRad(azimuth)) * rad;
-    int32_t xorig = skyw / 2 - dotw / 2;
-    int32_t yorig = skyh / 2 - doth / 2;
-    //    Serial.printf("IDX %d AZ %f DEC %f RAD %f X %d Y %d\n", idx, azimuth, declination, rad, x, y);
-    lv_obj_set_pos(satData[idx].dot, xorig + x, yorig - y);
-}
-
-// Initialise the sky view for the nunber of satellites. Removes any old ones not needed
-void initGNSSSky(uint32_t svs) {
-    for (int i = svs; i < MAXSATS; i++) {
-        if (satData[i].dot) {
-            lv_obj_del(satData[i].dot);
-            satData[i].dot = NULL;
-        }
+    int32_t x, y;
+    skyOffset(skyGeom.radius, azimuth, declination, x, y);
+    x = skyGeom.xorig + x;
+    y = skyGeom.yorig - y;
+    //    Serial.printf("IDX %d AZ %f DEC %f X %d Y %d\n", idx, azimuth, declination, x, y);
+    if (x == satData[idx].x && y == satData[idx].y) {
+        skyMovesSkipped++;
+        return;
+    }
+    if (satData[idx].x < 0) {
+        lv_obj_set_hidden(satData[idx].dot, false);
     }
+    satData[idx].x = x;
+    satData[idx].y = y;
+    lv_obj_set_pos(satData[idx].dot, x, y);
+    skyMoves++;
 }
 
-// Init the signal display to the number of SVs
-void initGNSSSignal(uint32_t svs) {
-    for (int i = svs; i < MAXSATS; i++) {
-        if (GNSSChartSeries->points[i]) {
-            GNSSChartSeries->points[i] = 0;
-            lv_chart_refresh(GNSSChart);
+// Finish an update. Satellites not reported for GNSS_EXPIRE ms have their
+// dot hidden and their bar cleared, and their slot is freed. The chart is
+// then resized and refreshed once.
+void commitGNSSUpdate() {
+    uint32_t now = millis();
+    for (int i = 0; i < MAXSATS; i++) {
+        SatData &sat = satData[i];
+        if (sat.used && now - sat.seen > GNSS_EXPIRE) {
+            sat.used = false;
+            prnSlot[sat.prn] = NO_SLOT;
+            if (sat.dot) {
+                lv_obj_set_hidden(sat.dot, true);
+            }
+            if (satSnr[i]) {
+                satSnr[i] = 0;
+                chartChanged();
+            }
         }
     }
-}
\ No newline at end of file
+    gnssBatch = false;
+    applyChart();
+}
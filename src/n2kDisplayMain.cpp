@@ -47,6 +47,9 @@ OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 // PGN and time handler
 #include <handlePGN.h>
 
+// Main loop scheduling
+#include <GwSched.h>
+
 // Define the console to output to serial at startup.
 // this can get changed later, eg in the gwshell.
 Stream *Console = &Serial;
@@ -66,17 +69,21 @@ void setup() {
     setup_logging();
     // Finally load the first working screen
     loadScreen();
+
+    // Add the work functions. Each one says when it next needs to run.
+    schedSetup();
+    schedAdd("admin", adminWork);
+    schedAdd("wifi", wifiWork);
+    schedAdd("web", webServerWork);
+    schedAdd("display", displayWork);
+    schedAdd("meters", metersWork);
+    schedAdd("wifiCheck", wifiCheck);
+    schedAdd("time", updateTime);
+    schedAdd("log", logWork);
     Serial.println("Setup done...");
 }
 
-// loop calling the work functions
+// loop running the work functions as they fall due
 void loop(void) {
-
-    adminWork();
-    wifiWork();
-    webServerWork();
-    metersWork();
-    wifiCheck();
-    updateTime();
-    delay(50);
+    schedRun();
 }
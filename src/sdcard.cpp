@@ -48,6 +48,17 @@ bool hasSdCard() {
   return hasSD;
 }
 
+// Serialises access to the card between tasks
+static SemaphoreHandle_t sdMutex = xSemaphoreCreateMutex();
+
+void sdLock() {
+  xSemaphoreTake(sdMutex, portMAX_DELAY);
+}
+
+void sdUnlock() {
+  xSemaphoreGive(sdMutex);
+}
+
 //------------------------------------------------------------------------------
 
 cid_t cid;
@@ -16,4 +16,16 @@ bool hasSdCard();
 const char * getCardType();
 uint32_t getCapacity();
 
+// SdFat is not thread safe. The log writer task and the main loop both use
+// the card so each access is made while holding the SD lock.
+void sdLock();
+void sdUnlock();
+
+// Holds the SD lock for the life of the object
+class SdLock {
+public:
+  SdLock() { sdLock(); }
+  ~SdLock() { sdUnlock(); }
+};
+
 #endif // __SDCARD_H
\ No newline at end of file
@@ -25,8 +25,13 @@ class Indicator {
    public:
     // Constructor:
     Indicator(lv_obj_t *parent, const char *label, uint32_t x, uint32_t y);
+    // Set the value text. Unchanged text is not redrawn.
     void setValue(const char *value);
 
+    // Counts of setValue calls that changed the text and that did not
+    static uint32_t updates;
+    static uint32_t skipped;
+
     // private:
     lv_obj_t *container;
     lv_obj_t *label;
@@ -35,11 +40,15 @@ class Indicator {
 
 // void metersTask(void* param);
 void metersSetup();
-void metersWork();
+uint32_t metersWork();
+uint32_t displayWork();
+void getDisplayStats(Stream &s);
+void getGfxStats(Stream &s);
 void setMeter(int scr, int ind, double, const char *);
 void setMeter(int scr, int ind, char *);
 void setGauge(int scr, double);
 void setVlabel(int, String &);
+void setVlabel(int, const char *);
 void setilabel(int scr, String &);
 void loadScreen();
 void displayText(const char *);
@@ -82,12 +91,13 @@ typedef enum {
     WINDANGLE = 5,
 } MeterIdx;
 
-// Set a signal strength indicator for index idx
-void setGNSSSignal(uint32_t idx, uint32_t val);
+// Satellites in view are updated between beginGNSSUpdate and commitGNSSUpdate.
+// The commit removes any that have not been set for a couple of seconds.
+void beginGNSSUpdate();
+void commitGNSSUpdate();
 
-// Display a satellite position using its azimuth and declination
-void setGNSSSky(uint32_t idx, double azimuth, double declination);
+// Set the signal strength bar for a satellite
+void setGNSSSignal(uint8_t prn, uint32_t val);
 
-// Clear the sky indicators
-void initGNSSSky(uint32_t);
-void initGNSSSignal(uint32_t);
\ No newline at end of file
+// Display a satellite position using its azimuth and declination
+void setGNSSSky(uint8_t prn, double azimuth, double declination);
\ No newline at end of file
@@ -0,0 +1,185 @@
+// Benchmark of PGN dispatch, registry hash index against a switch
+/*
+Copyright (c) 2024 Peter Martin www.naiadhome.com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// Times finding and calling the decoder for a message through PgnIndex, as
+// handlePGN does, against the switch statement it replaced. The messages
+// follow a typical mix on a small boat's network, including PGNs with no
+// decoder, which all reach handlePGN when a binary log is kept.
+// The decoders here only touch the message so the dispatch is what is timed.
+// The PGNs are those in the registry in src/handlePGN.cpp.
+//
+// Build and run from the top of the repo:
+//   g++ -O2 -std=gnu++11 -Itools/host -Isrc -o dispatchbench
+//       tools/dispatchbench/dispatchbench.cpp
+//   ./dispatchbench [messages]
+
+#include <Arduino.h>
+#include <N2kMsg.h>
+#include <PgnIndex.h>
+
+#include <chrono>
+#include <vector>
+
+static uint32_t sink;
+
+typedef void (*Decoder)(const tN2kMsg &msg);
+
+#define DECODER(pgn)                                                   \
+    __attribute__((noinline)) static void decode##pgn(const tN2kMsg &msg) { \
+        sink += msg.Data[0] + pgn;                                     \
+    }
+
+DECODER(127488)
+DECODER(127508)
+DECODER(128267)
+DECODER(129026)
+DECODER(129029)
+DECODER(129540)
+DECODER(130306)
+DECODER(130310)
+DECODER(130312)
+DECODER(130313)
+DECODER(130314)
+
+struct Handler {
+    uint32_t pgn;
+    const char *name;
+    Decoder decode;
+};
+
+static const Handler handlers[] = {
+    {127488, "Engine Rapid", decode127488},
+    {127508, "Battery Status", decode127508},
+    {128267, "Depth Data", decode128267},
+    {129026, "COG/SOG", decode129026},
+    {129029, "GNSS", decode129029},
+    {129540, "GNSS Sats in view", decode129540},
+    {130306, "Wind Data", decode130306},
+    {130310, "Outside environment", decode130310},
+    {130312, "Temperature", decode130312},
+    {130313, "Humidity", decode130313},
+    {130314, "Pressure", decode130314},
+    {60928, "IsoAddress", NULL},
+    {126992, "System Time", NULL},
+    {126996, "Product Information", NULL},
+    {127250, "Magnetic Heading", NULL},
+    {127489, "Engine Dynamic", NULL},
+    {127513, "Battery Configuration", NULL},
+    {129539, "GNSS DOP", NULL},
+    {130311, "Environmental Parameters", NULL},
+};
+
+static PgnIndex<Handler, 6> pgnIndex(handlers, sizeof(handlers) / sizeof(handlers[0]));
+
+__attribute__((noinline)) static bool dispatchIndex(const tN2kMsg &msg) {
+    const Handler *h = pgnIndex.find(msg.PGN);
+    if (!h || !h->decode) {
+        return false;
+    }
+    h->decode(msg);
+    return true;
+}
+
+// The old way, one case per PGN
+__attribute__((noinline)) static bool dispatchSwitch(const tN2kMsg &msg) {
+    switch (msg.PGN) {
+        case 127488: decode127488(msg); break;
+        case 127508: decode127508(msg); break;
+        case 128267: decode128267(msg); break;
+        case 129026: decode129026(msg); break;
+        case 129029: decode129029(msg); break;
+        case 129540: decode129540(msg); break;
+        case 130306: decode130306(msg); break;
+        case 130310: decode130310(msg); break;
+        case 130312: decode130312(msg); break;
+        case 130313: decode130313(msg); break;
+        case 130314: decode130314(msg); break;
+        default: return false;
+    }
+    return true;
+}
+
+static double nowSecs() {
+    using namespace std::chrono;
+    return duration_cast<duration<double>>(steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char **argv) {
+    size_t count = argc > 1 ? strtoul(argv[1], NULL, 0) : 4000000;
+
+    // Roughly messages per second of each PGN on a small boat's network
+    static const struct {
+        uint32_t pgn;
+        int rate;
+    } mix[] = {
+        {127250, 10}, {127251, 10}, {127257, 10}, {129025, 10}, {130306, 10}, {127488, 10},
+        {129026, 4},  {129029, 1},  {129540, 1},  {128267, 2},  {128259, 2},  {127508, 1},
+        {130310, 1},  {130312, 1},  {130313, 1},  {130314, 1},  {126992, 1},  {129539, 1},
+        {60928, 1},   {59904, 1},   {127245, 10}, {130316, 1},
+    };
+    int total = 0;
+    for (auto &m : mix) {
+        total += m.rate;
+    }
+    std::vector<tN2kMsg> msgs(4096);
+    uint32_t rnd = 1;
+    for (tN2kMsg &msg : msgs) {
+        rnd = rnd * 1103515245 + 12345;
+        int pick = (rnd >> 8) % total;
+        size_t k = 0;
+        while (pick >= mix[k].rate) {
+            pick -= mix[k++].rate;
+        }
+        msg.SetPGN(mix[k].pgn);
+        msg.Data[0] = rnd >> 24;
+    }
+
+    // Both must handle the same messages
+    size_t handled = 0;
+    for (const tN2kMsg &msg : msgs) {
+        bool a = dispatchIndex(msg);
+        bool b = dispatchSwitch(msg);
+        if (a != b) {
+            printf("PGN %lu dispatched differently\n", msg.PGN);
+            return 1;
+        }
+        handled += a;
+    }
+    printf("%zu of %zu messages have a decoder\n", handled, msgs.size());
+
+    double t0 = nowSecs();
+    for (size_t i = 0; i < count; i++) {
+        dispatchSwitch(msgs[i & (msgs.size() - 1)]);
+    }
+    double switchSecs = nowSecs() - t0;
+
+    t0 = nowSecs();
+    for (size_t i = 0; i < count; i++) {
+        dispatchIndex(msgs[i & (msgs.size() - 1)]);
+    }
+    double indexSecs = nowSecs() - t0;
+
+    printf("switch    %6.2f ns per message\n", switchSecs * 1e9 / count);
+    printf("PgnIndex  %6.2f ns per message\n", indexSecs * 1e9 / count);
+    printf("(checksum %u)\n", sink);
+    return 0;
+}
@@ -0,0 +1,301 @@
+// Replays fast packet frame streams through N2kFastPacket
+/*
+Copyright (c) 2024 Peter Martin www.naiadhome.com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// Host tests for the fast packet reassembler. Frame streams are replayed
+// in order, interleaved, out of order and with short frames, and the
+// messages that come out are checked byte for byte.
+//
+// Build and run from the top of the repo:
+//   g++ -O1 -g -std=gnu++11 -fsanitize=address,undefined -Itools/host -Isrc
+//       -o fptest tools/fastpacket/fptest.cpp src/N2kFastPacket.cpp
+//   ./fptest
+//
+// Exits non-zero if any check fails.
+
+#include <Arduino.h>
+#include <N2kFastPacket.h>
+
+static int failures;
+static int checks;
+
+#define CHECK(cond)                                                       \
+    do {                                                                  \
+        checks++;                                                         \
+        if (!(cond)) {                                                    \
+            failures++;                                                   \
+            fprintf(stderr, "%s:%d: FAILED %s\n", __FILE__, __LINE__, #cond); \
+        }                                                                 \
+    } while (0)
+
+// Payload byte i of a test message from a given source
+static uint8_t payload(uint8_t source, int i) {
+    return (uint8_t)(source * 31 + i * 7 + 1);
+}
+
+// Build frame number counter of a fast packet message of len bytes
+static tN2kMsg frameOf(uint32_t pgn, uint8_t source, uint8_t seq, int counter, int len) {
+    tN2kMsg f;
+    f.SetPGN(pgn);
+    f.Source = source;
+    f.Priority = 2;
+    f.Data[0] = (seq << 5) | counter;
+    int start, n, at;
+    if (counter == 0) {
+        f.Data[1] = len;
+        start = 0;
+        n = 6;
+        at = 2;
+    } else {
+        start = 6 + (counter - 1) * 7;
+        n = 7;
+        at = 1;
+    }
+    for (int i = 0; i < n; i++) {
+        f.Data[at + i] = start + i < len ? payload(source, start + i) : 0xff;
+    }
+    f.DataLen = 8;
+    return f;
+}
+
+// Frames in a message of len bytes
+static int framesFor(int len) {
+    return len <= 6 ? 1 : 1 + (len - 6 + 6) / 7;
+}
+
+// True if msg is the whole test message
+static bool matches(const tN2kMsg *msg, uint32_t pgn, uint8_t source, int len) {
+    if (!msg || msg->PGN != pgn || msg->Source != source || msg->DataLen != len) {
+        return false;
+    }
+    for (int i = 0; i < len; i++) {
+        if (msg->Data[i] != payload(source, i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void testSingleFrame() {
+    N2kFastPacket fp;
+    tN2kMsg f;
+    f.SetPGN(127250);
+    f.DataLen = 8;
+    CHECK(fp.add(f, 0) == &f);
+    CHECK(fp.completed == 0);
+}
+
+static void testInOrder() {
+    N2kFastPacket fp;
+    const int len = 43;     // 129029 GNSS position
+    int frames = framesFor(len);
+    tN2kMsg *out = NULL;
+    for (int i = 0; i < frames; i++) {
+        tN2kMsg f = frameOf(129029, 5, 3, i, len);
+        out = fp.add(f, i);
+        if (i < frames - 1) {
+            CHECK(out == NULL);
+        }
+    }
+    CHECK(matches(out, 129029, 5, len));
+    CHECK(fp.completed == 1);
+    CHECK(fp.dropped == 0);
+    CHECK(fp.outOfOrder == 0);
+}
+
+// Two senders, and two sequences from the same sender, interleaved frame
+// by frame
+static void testInterleaved() {
+    N2kFastPacket fp;
+    struct {
+        uint32_t pgn;
+        uint8_t source;
+        uint8_t seq;
+        int len;
+        int sent;
+        bool done;
+    } streams[] = {
+        {129029, 5, 1, 43, 0, false},
+        {129540, 9, 2, 200, 0, false},
+        {129029, 9, 6, 43, 0, false},
+        {129540, 9, 3, 77, 0, false},
+    };
+    const int count = sizeof(streams) / sizeof(streams[0]);
+    uint32_t now = 0;
+    bool more = true;
+    while (more) {
+        more = false;
+        for (int s = 0; s < count; s++) {
+            if (streams[s].sent >= framesFor(streams[s].len)) {
+                continue;
+            }
+            tN2kMsg f = frameOf(streams[s].pgn, streams[s].source, streams[s].seq, streams[s].sent++,
+                                streams[s].len);
+            tN2kMsg *out = fp.add(f, now++);
+            if (out) {
+                CHECK(!streams[s].done);
+                CHECK(streams[s].sent == framesFor(streams[s].len));
+                CHECK(matches(out, streams[s].pgn, streams[s].source, streams[s].len));
+                streams[s].done = true;
+            }
+            more = true;
+        }
+    }
+    for (int s = 0; s < count; s++) {
+        CHECK(streams[s].done);
+    }
+    CHECK(fp.completed == count);
+    CHECK(fp.dropped == 0);
+}
+
+static void testOutOfOrder() {
+    N2kFastPacket fp;
+    const int len = 43;
+
+    // A continuation with no first frame
+    tN2kMsg f = frameOf(129029, 5, 1, 2, len);
+    CHECK(fp.add(f, 0) == NULL);
+    CHECK(fp.outOfOrder == 1);
+
+    // Frames 0, 2: the gap drops the sequence and the rest are ignored
+    f = frameOf(129029, 5, 1, 0, len);
+    CHECK(fp.add(f, 1) == NULL);
+    f = frameOf(129029, 5, 1, 2, len);
+    CHECK(fp.add(f, 2) == NULL);
+    CHECK(fp.dropped == 1);
+    for (int i = 3; i < framesFor(len); i++) {
+        f = frameOf(129029, 5, 1, i, len);
+        CHECK(fp.add(f, i) == NULL);
+    }
+    CHECK(fp.completed == 0);
+
+    // A repeated first frame restarts the sequence
+    f = frameOf(129029, 5, 1, 0, len);
+    fp.add(f, 10);
+    f = frameOf(129029, 5, 1, 1, len);
+    fp.add(f, 11);
+    tN2kMsg *out = NULL;
+    for (int i = 0; i < framesFor(len); i++) {
+        f = frameOf(129029, 5, 1, i, len);
+        out = fp.add(f, 12 + i);
+    }
+    CHECK(matches(out, 129029, 5, len));
+    CHECK(fp.completed == 1);
+}
+
+static void testShortFrames() {
+    N2kFastPacket fp;
+
+    // The last frame may be short
+    const int len = 20;
+    tN2kMsg *out = NULL;
+    for (int i = 0; i < framesFor(len); i++) {
+        tN2kMsg f = frameOf(129029, 7, 0, i, len);
+        if (i == framesFor(len) - 1) {
+            f.DataLen = 1 + (len - 6 - (i - 1) * 7);
+        }
+        out = fp.add(f, i);
+    }
+    CHECK(matches(out, 129029, 7, len));
+
+    // A short frame before the end drops the sequence rather than
+    // putting the next frame's bytes in the wrong place
+    uint32_t dropped = fp.dropped;
+    tN2kMsg f = frameOf(129029, 7, 1, 0, 10);
+    CHECK(fp.add(f, 10) == NULL);
+    f = frameOf(129029, 7, 1, 1, 10);
+    f.DataLen = 3;
+    CHECK(fp.add(f, 11) == NULL);
+    CHECK(fp.dropped == dropped + 1);
+    f = frameOf(129029, 7, 1, 2, 10);
+    CHECK(fp.add(f, 12) == NULL);
+
+    // A short first frame that does not hold the whole message
+    f = frameOf(129029, 7, 2, 0, 30);
+    f.DataLen = 5;
+    CHECK(fp.add(f, 13) == NULL);
+    f = frameOf(129029, 7, 2, 1, 30);
+    CHECK(fp.add(f, 14) == NULL);
+
+    // Frames too short to have a header, and a length too big for a message
+    f = frameOf(129029, 7, 3, 0, 30);
+    f.DataLen = 1;
+    CHECK(fp.add(f, 15) == NULL);
+    f = frameOf(129029, 7, 3, 0, 30);
+    f.Data[1] = 250;
+    CHECK(fp.add(f, 16) == NULL);
+
+    // Every short length of every frame position, none may complete
+    // wrongly or write out of bounds
+    for (int pos = 0; pos < 4; pos++) {
+        for (int dl = 0; dl < 8; dl++) {
+            N2kFastPacket p;
+            for (int i = 0; i < 5; i++) {
+                tN2kMsg g = frameOf(129029, 8, 4, i, 31);
+                if (i == pos) {
+                    g.DataLen = dl;
+                }
+                tN2kMsg *got = p.add(g, i);
+                CHECK(got == NULL || (i == 4 && matches(got, 129029, 8, 31)));
+            }
+        }
+    }
+    CHECK(fp.completed == 1);
+}
+
+static void testTimeoutAndPool() {
+    N2kFastPacket fp;
+    const int len = 43;
+
+    // A sequence left unfinished is abandoned after FP_TIMEOUT
+    tN2kMsg f = frameOf(129029, 5, 1, 0, len);
+    fp.add(f, 0);
+    f = frameOf(129029, 5, 1, 1, len);
+    CHECK(fp.add(f, FP_TIMEOUT + 1) == NULL);
+    CHECK(fp.dropped == 1);
+    CHECK(fp.outOfOrder == 1);
+
+    // More sequences than slots: the oldest is dropped for the newest
+    for (int s = 0; s <= FP_SLOTS; s++) {
+        f = frameOf(129029, 20 + s, 0, 0, len);
+        fp.add(f, 1000 + s);
+    }
+    CHECK(fp.dropped == 2);
+    f = frameOf(129029, 20, 0, 1, len);
+    CHECK(fp.add(f, 1100) == NULL);
+    tN2kMsg *out = NULL;
+    for (int i = 1; i < framesFor(len); i++) {
+        f = frameOf(129029, 20 + FP_SLOTS, 0, i, len);
+        out = fp.add(f, 1100 + i);
+    }
+    CHECK(matches(out, 129029, 20 + FP_SLOTS, len));
+}
+
+int main() {
+    testSingleFrame();
+    testInOrder();
+    testInterleaved();
+    testOutOfOrder();
+    testShortFrames();
+    testTimeoutAndPool();
+    printf("%d checks, %d failed\n", checks, failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,112 @@
+// Just enough of the Arduino core to build the display's portable modules
+// on a Linux host for the tests and benchmarks under tools/
+/*
+Copyright (c) 2024 Peter Martin www.naiadhome.com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+
+typedef int esp_err_t;
+
+static inline uint32_t micros() {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static inline uint32_t millis() {
+    return micros() / 1000;
+}
+
+// Output goes to stdout
+class Stream {
+   public:
+    virtual ~Stream() {}
+    virtual size_t write(uint8_t c) {
+        return fputc(c, stdout) == EOF ? 0 : 1;
+    }
+    size_t write(const char *s, size_t n) {
+        size_t done = 0;
+        while (done < n && write((uint8_t)s[done])) {
+            done++;
+        }
+        return done;
+    }
+    size_t print(const char *s) {
+        return write(s, strlen(s));
+    }
+    size_t print(unsigned long n) {
+        return printf("%lu", n);
+    }
+    size_t println(const char *s = "") {
+        return print(s) + print("\r\n");
+    }
+    size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3))) {
+        char buf[512];
+        va_list args;
+        va_start(args, fmt);
+        int n = vsnprintf(buf, sizeof(buf), fmt, args);
+        va_end(args);
+        if (n < 0) {
+            return 0;
+        }
+        return write(buf, (size_t)n < sizeof(buf) ? n : sizeof(buf) - 1);
+    }
+};
+
+// The few String calls the portable modules and the tests make
+class String {
+   public:
+    String(const char *s = "") : str(s) {}
+    String(double value, unsigned int dp) {
+        char buf[48];
+        snprintf(buf, sizeof(buf), "%.*f", dp, value);
+        str = buf;
+    }
+    const char *c_str() const { return str.c_str(); }
+    size_t length() const { return str.length(); }
+    String &operator+=(const char *s) {
+        str += s;
+        return *this;
+    }
+    String &operator+=(const String &s) {
+        str += s.str;
+        return *this;
+    }
+    String operator+(const char *s) const {
+        String r(*this);
+        r += s;
+        return r;
+    }
+    bool operator==(const char *s) const { return str == s; }
+
+   private:
+    std::string str;
+};
+
+static Stream Serial;
@@ -0,0 +1,41 @@
+// Host stand in for the NMEA2000 library's tN2kMsg. Same members as the
+// library so the display's modules build against it unchanged.
+/*
+Copyright (c) 2024 Peter Martin www.naiadhome.com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+class tN2kMsg {
+   public:
+    static const int MaxDataLen = 223;
+    unsigned char Priority = 6;
+    unsigned long PGN = 0;
+    mutable unsigned char Source = 0;
+    mutable unsigned char Destination = 0xff;
+    int DataLen = 0;
+    unsigned char Data[MaxDataLen];
+    unsigned long MsgTime = 0;
+
+    tN2kMsg() { memset(Data, 0, sizeof(Data)); }
+    void SetPGN(unsigned long pgn) { PGN = pgn; }
+};
@@ -0,0 +1,193 @@
+// Heap test for the log record builder
+/*
+Copyright (c) 2024 Peter Martin www.naiadhome.com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// Builds log records the way the PGN decoders do, many times over, and
+// counts every malloc, calloc, realloc and operator new made while doing
+// it. Building a record, adding values to a disabled one and ending one
+// must not touch the heap at all, so nothing can fragment it however long
+// the display runs. Each record is also checked to be whole JSON, and a
+// record that overflows its buffer is checked to still be closed.
+//
+// Build and run from the top of the repo:
+//   g++ -O2 -std=gnu++11 -Itools/host -Isrc -o logrecordtest
+//       tools/logrecordtest/logrecordtest.cpp src/LogRecord.cpp src/NumFormat.cpp
+//   ./logrecordtest [messages]
+//
+// Uses glibc's __libc_malloc to count allocations. Exits non-zero on failure.
+
+#include <Arduino.h>
+#include <LogRecord.h>
+
+#include <new>
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *p, size_t size);
+void __libc_free(void *p);
+}
+
+static volatile size_t allocations;
+
+extern "C" void *malloc(size_t size) {
+    allocations++;
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t n, size_t size) {
+    allocations++;
+    return __libc_calloc(n, size);
+}
+
+extern "C" void *realloc(void *p, size_t size) {
+    allocations++;
+    return __libc_realloc(p, size);
+}
+
+extern "C" void free(void *p) {
+    __libc_free(p);
+}
+
+void *operator new(size_t size) {
+    allocations++;
+    void *p = __libc_malloc(size);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    __libc_free(p);
+}
+
+// True if the braces and quotes in a record balance and it is closed
+static bool wellFormed(const char *s) {
+    int depth = 0;
+    bool quoted = false;
+    for (; *s; s++) {
+        if (*s == '"') {
+            quoted = !quoted;
+        } else if (!quoted && *s == '{') {
+            depth++;
+        } else if (!quoted && *s == '}') {
+            if (--depth < 0) {
+                return false;
+            }
+        }
+    }
+    return depth == 0 && !quoted;
+}
+
+// The records the decoders in handlePGN.cpp make
+static const char *build(LogRecord &record, uint32_t n) {
+    double v = (n % 1000) / 7.0;
+    switch (n % 6) {
+        case 0:
+            record.add("rpm", (int32_t)(n % 3500));
+            break;
+        case 1:
+            record.add("instance", (int32_t)(n & 1));
+            record.add("housev", 12.0 + v / 100, 2);
+            record.add("housei", -v, 1);
+            break;
+        case 2:
+            record.add("lat", 50.0 + v / 1000, 6);
+            record.add("lon", -1.0 - v / 1000, 6);
+            record.add("time", "2024-7-28 10:17:38");
+            record.add("days", (int32_t)19932);
+            record.add("seconds", v * 100, 1);
+            break;
+        case 3:
+            record.add("sog", v / 10, 1);
+            record.add("cog", v, 1);
+            break;
+        case 4:
+            record.add("angle", v, 1);
+            record.add("wind", v / 20, 1);
+            break;
+        case 5:
+            record.add("pressure", (int32_t)(1000 + n % 40));
+            break;
+    }
+    return record.end();
+}
+
+int main(int argc, char **argv) {
+    uint32_t count = argc > 1 ? strtoul(argv[1], NULL, 0) : 1000000;
+    int failures = 0;
+    static LogRecord record;
+
+    // Make sure the counting hooks are in place before trusting a zero
+    size_t before = allocations;
+    free(malloc(16));
+    delete new int;
+    if (allocations - before != 2) {
+        printf("Allocation counting is not working\n");
+        return 1;
+    }
+
+    // Logging on
+    before = allocations;
+    uint32_t bad = 0;
+    for (uint32_t n = 0; n < count; n++) {
+        record.begin(127488 + n % 6, n, "2024-7-28 10:17:38");
+        if (!wellFormed(build(record, n))) {
+            bad++;
+        }
+    }
+    size_t used = allocations - before;
+    printf("Logging on   %u records, %zu allocations, %u malformed\n", count, used, bad);
+    failures += used != 0 || bad != 0;
+
+    // Logging off: values are ignored and nothing is built
+    before = allocations;
+    uint32_t fields = 0;
+    for (uint32_t n = 0; n < count; n++) {
+        record.disable();
+        double v = n / 3.0;
+        record.add("sog", v, 1);
+        record.add("rpm", (int32_t)n);
+        record.add("time", "2024-7-28 10:17:38");
+        fields += record.fields();
+    }
+    used = allocations - before;
+    printf("Logging off  %u messages, %zu allocations, %u fields kept\n", count, used, fields);
+    failures += used != 0 || fields != 0;
+
+    // A record with more values than fit is cut at a whole value
+    before = allocations;
+    record.begin(129029, 1, "2024-7-28 10:17:38");
+    char name[16];
+    for (int i = 0; i < 100; i++) {
+        snprintf(name, sizeof(name), "value%d", i);
+        record.add(name, i * 1.5, 3);
+    }
+    const char *full = record.end();
+    used = allocations - before;
+    bool ok = wellFormed(full) && strlen(full) < LOG_RECORD_SIZE && record.fields() < 100;
+    printf("Overflow     %u values kept, %zu chars, %zu allocations: %s\n", record.fields(), strlen(full), used,
+           ok ? "ok" : "FAILED");
+    failures += !ok || used != 0;
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,687 @@
+// Convert binary N2K capture files to JSON or CSV
+/*
+Copyright (c) 2024 Peter Martin www.naiadhome.com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// A Linux command line tool for the .n2k capture files written by the
+// display's logger. The format is described in src/N2kCapture.h.
+//
+// Build:
+//   g++ -O2 -std=c++11 -o n2kcap tools/n2kcap/n2kcap.cpp
+//
+// Usage:
+//   n2kcap [-f json|csv] [-d] [-v] file...
+//   n2kcap -i file...
+//
+//   -f   Output format, json (default) or csv
+//   -d   Decode the PGNs the display handles into the same fields as its
+//        JSON log. Other messages are left out.
+//   -v   Print record, sync and error counts to stderr at the end
+//   -i   Write the time index for each log, capture or JSON text, as the
+//        logger does. See src/LogIndex.h.
+//
+// Without -d every message is written with its raw payload in hex.
+// Files are mapped into memory and the output is built in a large buffer,
+// so gigabytes of captures convert in seconds.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../../src/LogIndex.h"
+#include "../../src/N2kCapture.h"
+
+// Output buffer flushed to stdout when nearly full
+class Out {
+   public:
+    Out() : len(0) {}
+    ~Out() { flush(); }
+
+    void flush() {
+        if (len && fwrite(buf, 1, len, stdout) != len) {
+            perror("n2kcap: write");
+            exit(1);
+        }
+        len = 0;
+    }
+
+    void put(char c) {
+        room(1);
+        buf[len++] = c;
+    }
+
+    void put(const char *s) { put(s, strlen(s)); }
+
+    void put(const char *s, size_t n) {
+        room(n);
+        memcpy(buf + len, s, n);
+        len += n;
+    }
+
+    void putUint(uint64_t v) {
+        char digits[24];
+        char *p = digits + sizeof(digits);
+        do {
+            *--p = '0' + v % 10;
+            v /= 10;
+        } while (v);
+        put(p, digits + sizeof(digits) - p);
+    }
+
+    void putInt(int64_t v) {
+        if (v < 0) {
+            put('-');
+            putUint(-(uint64_t)v);
+        } else {
+            putUint(v);
+        }
+    }
+
+    // A value rounded to dp places, as the display's logger writes it
+    void putFixed(double v, int dp) {
+        static const double scale[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000};
+        int64_t scaled = (int64_t)(v * scale[dp] + (v < 0 ? -0.5 : 0.5));
+        if (scaled < 0) {
+            put('-');
+            scaled = -scaled;
+        }
+        uint64_t whole = scaled / (int64_t)scale[dp];
+        uint64_t frac = scaled % (int64_t)scale[dp];
+        putUint(whole);
+        if (dp) {
+            put('.');
+            char digits[8];
+            for (int i = dp - 1; i >= 0; i--) {
+                digits[i] = '0' + frac % 10;
+                frac /= 10;
+            }
+            put(digits, dp);
+        }
+    }
+
+    void putHex(const uint8_t *p, size_t n) {
+        static const char hex[] = "0123456789abcdef";
+        room(n * 2);
+        for (size_t i = 0; i < n; i++) {
+            buf[len++] = hex[p[i] >> 4];
+            buf[len++] = hex[p[i] & 0x0F];
+        }
+    }
+
+   private:
+    void room(size_t n) {
+        if (len + n > sizeof(buf)) {
+            flush();
+        }
+    }
+
+    char buf[1 << 20];
+    size_t len;
+};
+
+static Out out;
+
+enum Format { FMT_JSON, FMT_CSV };
+static Format format = FMT_JSON;
+static bool decode = false;
+static bool makeIndex = false;
+static bool verbose = false;
+
+// Counts over all the files
+static struct {
+    uint64_t records;
+    uint64_t syncs;
+    uint64_t crcErrors;
+    uint64_t skipped;   // Bytes passed over looking for a sync marker
+    uint64_t decoded;
+} stats;
+
+// A message being converted
+struct Frame {
+    uint32_t ms;
+    uint32_t epoch;     // UTC seconds, 0 if the clock was not known
+    uint32_t pgn;
+    uint8_t priority;
+    uint8_t source;
+    uint8_t destination;
+    uint8_t len;
+    const uint8_t *data;
+};
+
+// The time key used by the display's JSON log, eg 2024-7-28 10:17:38
+static void putTimeKey(uint32_t epoch) {
+    static uint32_t last = UINT32_MAX;
+    static char key[32];
+    static size_t keyLen;
+    if (epoch != last) {
+        time_t t = epoch;
+        struct tm tm;
+        gmtime_r(&t, &tm);
+        keyLen = snprintf(key, sizeof(key), "%d-%d-%d %d:%d:%d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+                          tm.tm_hour, tm.tm_min, tm.tm_sec);
+        last = epoch;
+    }
+    out.put(key, keyLen);
+}
+
+//------------------------------------------------------------------------------
+// Field decoding, matching the decoders in src/handlePGN.cpp
+
+#define msToKnots(v) ((v) * 3600.0 / 1852.0)
+#define RadToDeg(v) ((v) * 180.0 / M_PI)
+#define KelvinToC(v) ((v) - 273.15)
+
+static inline uint16_t get16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+static inline int16_t geti16(const uint8_t *p) { return (int16_t)get16(p); }
+static inline uint32_t get32(const uint8_t *p) { return n2kcapGet32(p); }
+static inline int64_t geti64(const uint8_t *p) { return (int64_t)((uint64_t)get32(p) | ((uint64_t)get32(p + 4) << 32)); }
+
+// Collects the fields of one decoded message in either output format
+class Fields {
+   public:
+    explicit Fields(const Frame &f) : frame(f), count(0) {}
+
+    ~Fields() {
+        if (count && format == FMT_JSON) {
+            out.put("}}\n");
+        }
+        if (count) {
+            stats.decoded++;
+        }
+    }
+
+    void add(const char *name, int64_t v) {
+        start(name);
+        out.putInt(v);
+        end();
+    }
+
+    void add(const char *name, double v, int dp) {
+        start(name);
+        out.putFixed(v, dp);
+        end();
+    }
+
+    void add(const char *name, const char *v) {
+        start(name);
+        if (format == FMT_JSON) {
+            out.put('"');
+            out.put(v);
+            out.put('"');
+        } else {
+            out.put(v);
+        }
+        end();
+    }
+
+   private:
+    void start(const char *name) {
+        if (format == FMT_JSON) {
+            if (!count) {
+                out.put("{\"PGN\":");
+                out.putUint(frame.pgn);
+                out.put(",\"ms\":");
+                out.putUint(frame.ms);
+                out.put(",\"");
+                putTimeKey(frame.epoch);
+                out.put("\":{");
+            } else {
+                out.put(',');
+            }
+            out.put('"');
+            out.put(name);
+            out.put("\":");
+        } else {
+            out.putUint(frame.ms);
+            out.put(',');
+            putTimeKey(frame.epoch);
+            out.put(',');
+            out.putUint(frame.pgn);
+            out.put(',');
+            out.put(name);
+            out.put(',');
+        }
+        count++;
+    }
+
+    void end() {
+        if (format == FMT_CSV && !makeIndex) {
+            out.put('\n');
+        }
+    }
+
+    const Frame &frame;
+    int count;
+};
+
+static void decodeFrame(const Frame &f) {
+    const uint8_t *d = f.data;
+    Fields record(f);
+    switch (f.pgn) {
+        case 127508:  // Battery Status
+            if (f.len >= 8) {
+                uint8_t instance = d[0];
+                int16_t volts = geti16(d + 1);
+                int16_t amps = geti16(d + 3);
+                if (volts == 0x7FFF || amps == 0x7FFF) {
+                    break;
+                }
+                if (instance == 0) {
+                    record.add("instance", (int64_t)instance);
+                    record.add("housev", volts * 0.01, 2);
+                    record.add("housei", amps * 0.1, 2);
+                } else if (instance == 1) {
+                    record.add("instance", (int64_t)instance);
+                    record.add("enginev", volts * 0.01, 2);
+                }
+            }
+            break;
+
+        case 127488:  // Engine Rapid
+            if (f.len >= 8 && get16(d + 1) != 0xFFFF) {
+                double speed = get16(d + 1) * 0.25;
+                record.add("rpm", (int64_t)((int32_t)speed / 100));
+            }
+            break;
+
+        case 130306:  // Wind
+            if (f.len >= 6) {
+                if (get16(d + 3) != 0xFFFF) {
+                    record.add("angle", (int64_t)((int32_t)RadToDeg(get16(d + 3) * 0.0001) + 180));
+                }
+                if (get16(d + 1) != 0xFFFF) {
+                    record.add("wind", msToKnots(get16(d + 1) * 0.01), 1);
+                }
+            }
+            break;
+
+        case 129026:  // COG/SOG
+            if (f.len >= 8) {
+                if (get16(d + 4) != 0xFFFF) {
+                    record.add("sog", msToKnots(get16(d + 4) * 0.01), 1);
+                }
+                if (get16(d + 2) != 0xFFFF) {
+                    record.add("cog", (int64_t)(int32_t)RadToDeg(get16(d + 2) * 0.0001));
+                }
+            }
+            break;
+
+        case 128267:  // Depth
+            if (f.len >= 8 && get32(d + 1) != 0xFFFFFFFF) {
+                record.add("depth", get32(d + 1) * 0.01, 1);
+            }
+            break;
+
+        case 129029:  // GNSS position and time
+            if (f.len >= 43 && get16(d + 1) != 0xFFFF && get32(d + 3) != 0xFFFFFFFF) {
+                uint16_t days = get16(d + 1);
+                double seconds = get32(d + 3) * 0.0001;
+                uint32_t t = seconds;
+                char buf[16];
+                snprintf(buf, sizeof(buf), "%02u:%02u:%02u", t / 3600, t / 60 % 60, t % 60);
+                record.add("lat", geti64(d + 7) * 1e-16, 7);
+                record.add("lon", geti64(d + 15) * 1e-16, 7);
+                record.add("time", buf);
+                record.add("days", (int64_t)days);
+                record.add("seconds", seconds, 3);
+            }
+            break;
+
+        case 130310:  // Outside environment
+            if (f.len >= 7 && get16(d + 1) != 0xFFFF && get16(d + 1) * 0.01 > 273.0) {
+                record.add("seatemp", KelvinToC(get16(d + 1) * 0.01), 1);
+            }
+            break;
+
+        case 130312:  // Temperature
+            if (f.len >= 7 && get16(d + 3) != 0xFFFF) {
+                record.add("airtemp", KelvinToC(get16(d + 3) * 0.01), 1);
+            }
+            break;
+
+        case 130314:  // Pressure
+            if (f.len >= 7 && get32(d + 3) != 0x7FFFFFFF) {
+                double pressure = (int32_t)get32(d + 3) * 0.1;
+                record.add("pressure", (int64_t)((int32_t)pressure / 100));
+            }
+            break;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+static void rawFrame(const Frame &f) {
+    if (format == FMT_JSON) {
+        out.put("{\"ms\":");
+        out.putUint(f.ms);
+        out.put(",\"time\":\"");
+        putTimeKey(f.epoch);
+        out.put("\",\"pgn\":");
+        out.putUint(f.pgn);
+        out.put(",\"src\":");
+        out.putUint(f.source);
+        out.put(",\"dst\":");
+        out.putUint(f.destination);
+        out.put(",\"prio\":");
+        out.putUint(f.priority);
+        out.put(",\"data\":\"");
+        out.putHex(f.data, f.len);
+        out.put("\"}\n");
+    } else {
+        out.putUint(f.ms);
+        out.put(',');
+        putTimeKey(f.epoch);
+        out.put(',');
+        out.putUint(f.pgn);
+        out.put(',');
+        out.putUint(f.source);
+        out.put(',');
+        out.putUint(f.destination);
+        out.put(',');
+        out.putUint(f.priority);
+        out.put(',');
+        out.putUint(f.len);
+        out.put(',');
+        out.putHex(f.data, f.len);
+        out.put('\n');
+    }
+}
+
+// Find the next sync marker at or after p, or return end
+static const uint8_t *findSync(const uint8_t *p, const uint8_t *end) {
+    while (p < end) {
+        p = (const uint8_t *)memchr(p, N2KCAP_SYNC, end - p);
+        if (!p) {
+            return end;
+        }
+        if (end - p >= N2KCAP_SYNC_SIZE && memcmp(p + 1, N2KCAP_SYNC_MAGIC, 4) == 0) {
+            return p;
+        }
+        p++;
+    }
+    return end;
+}
+
+static bool convert(const char *name, const uint8_t *p, size_t size) {
+    const uint8_t *end = p + size;
+    if (size < N2KCAP_HEADER_SIZE || memcmp(p, N2KCAP_MAGIC, 6) != 0) {
+        fprintf(stderr, "n2kcap: %s: not a capture file\n", name);
+        return false;
+    }
+    if (p[6] != N2KCAP_VERSION) {
+        fprintf(stderr, "n2kcap: %s: unknown version %d\n", name, p[6]);
+        return false;
+    }
+
+    // Times are rebuilt from the deltas. The clock reference is the latest
+    // epoch and ms pair seen that had a set clock.
+    uint32_t ms = n2kcapGet32(p + 12);
+    uint32_t refEpoch = n2kcapGet32(p + 8);
+    uint32_t refMs = ms;
+    p += N2KCAP_HEADER_SIZE;
+
+    const uint8_t *crcStart = p;    // Start of the bytes the next sync covers
+    bool crcValid = true;           // False after a resync until the next marker
+
+    while (p < end) {
+        if (*p == N2KCAP_SYNC) {
+            if (end - p < N2KCAP_SYNC_SIZE || memcmp(p + 1, N2KCAP_SYNC_MAGIC, 4) != 0) {
+                goto resync;
+            }
+            uint32_t crc = n2kcapGet32(p + 17);
+            if (crcValid && n2kcapCrc32(0, crcStart, p - crcStart) != crc) {
+                stats.crcErrors++;
+                fprintf(stderr, "n2kcap: %s: CRC error before offset %ld\n", name, (long)(p - (end - size)));
+            }
+            stats.syncs++;
+            ms = n2kcapGet32(p + 9);
+            uint32_t epoch = n2kcapGet32(p + 13);
+            if (epoch) {
+                refEpoch = epoch;
+                refMs = ms;
+            }
+            p += N2KCAP_SYNC_SIZE;
+            crcStart = p;
+            crcValid = true;
+            continue;
+        }
+        if (*p > N2KCAP_MAX_DATA) {
+            goto resync;
+        }
+        {
+            uint32_t delta;
+            size_t n = n2kcapRecord(p, end - p, delta);
+            if (!n) {
+                if (end - p < N2KCAP_MAX_RECORD) {
+                    break;  // Cut short, eg the capture was still being written
+                }
+                goto resync;
+            }
+            Frame f;
+            f.len = p[0];
+            f.data = p + n - f.len;
+            n2kcapSplitId(n2kcapGet32(f.data - 4), f.priority, f.pgn, f.source, f.destination);
+            p += n;
+
+            ms += delta;
+            f.ms = ms;
+            f.epoch = refEpoch ? refEpoch + (int32_t)(ms - refMs) / 1000 : 0;
+            stats.records++;
+            if (decode) {
+                decodeFrame(f);
+            } else {
+                rawFrame(f);
+            }
+        }
+        continue;
+
+    resync:
+        {
+            const uint8_t *next = findSync(p + 1, end);
+            stats.skipped += next - p;
+            fprintf(stderr, "n2kcap: %s: bad record at offset %ld, skipped %ld bytes\n", name,
+                    (long)(p - (end - size)), (long)(next - p));
+            p = next;
+            crcValid = false;
+        }
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// Index building
+
+class IndexWriter {
+   public:
+    explicit IndexWriter(FILE *f) : file(f), entries(0) {}
+
+    void add(uint32_t epoch, uint32_t ms, size_t offset) {
+        uint8_t buf[LOG_INDEX_SIZE];
+        LogIndexEntry e = {epoch, ms, (uint32_t)offset};
+        logIndexPut(buf, e);
+        fwrite(buf, 1, sizeof(buf), file);
+        entries++;
+    }
+
+    FILE *file;
+    uint32_t entries;
+};
+
+// A capture is indexed after its header and each sync marker
+static void indexCapture(IndexWriter &index, const uint8_t *start, const uint8_t *end) {
+    const uint8_t *p = start;
+    index.add(n2kcapGet32(p + 8), n2kcapGet32(p + 12), N2KCAP_HEADER_SIZE);
+    p += N2KCAP_HEADER_SIZE;
+    while (p < end) {
+        uint32_t delta;
+        size_t n = 0;
+        if (*p == N2KCAP_SYNC) {
+            if (end - p >= N2KCAP_SYNC_SIZE && memcmp(p + 1, N2KCAP_SYNC_MAGIC, 4) == 0) {
+                index.add(n2kcapGet32(p + 13), n2kcapGet32(p + 9), p + N2KCAP_SYNC_SIZE - start);
+                n = N2KCAP_SYNC_SIZE;
+            }
+        } else if (*p <= N2KCAP_MAX_DATA) {
+            n = n2kcapRecord(p, end - p, delta);
+        }
+        p = n ? p + n : findSync(p + 1, end);
+    }
+}
+
+// A JSON text log gets an entry every LOG_INDEX_RECORDS lines or LOG_INDEX_MS,
+// using the ms and time key at the start of each line
+static void indexText(IndexWriter &index, const uint8_t *start, const uint8_t *end) {
+    uint32_t lines = 0;
+    uint32_t lastMs = 0;
+    bool due = true;
+    for (const uint8_t *p = start; p < end;) {
+        const uint8_t *eol = (const uint8_t *)memchr(p, '\n', end - p);
+        eol = eol ? eol + 1 : end;
+
+        // Only the start of a line is needed
+        char line[80];
+        size_t len = eol - p < (long)sizeof(line) - 1 ? eol - p : sizeof(line) - 1;
+        memcpy(line, p, len);
+        line[len] = 0;
+
+        unsigned ms;
+        int year, month, day, hour, minute, second;
+        const char *field = strstr(line, "\"ms\":");
+        if (field && sscanf(field, "\"ms\":%u,\"%d-%d-%d %d:%d:%d", &ms, &year, &month, &day, &hour, &minute,
+                            &second) == 7) {
+            if (due || ++lines >= LOG_INDEX_RECORDS || ms - lastMs >= LOG_INDEX_MS) {
+                uint32_t epoch = logIndexEpoch(year, month, day, hour, minute, second);
+                index.add(epoch > LOG_CLOCK_SET ? epoch : 0, ms, p - start);
+                lines = 0;
+                lastMs = ms;
+                due = false;
+            }
+        }
+        p = eol;
+    }
+}
+
+static bool indexLog(const char *name, const uint8_t *p, size_t size) {
+    char path[PATH_MAX];
+    logIndexName(path, sizeof(path), name);
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "n2kcap: %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    IndexWriter index(f);
+    bool capture = size >= N2KCAP_HEADER_SIZE && memcmp(p, N2KCAP_MAGIC, 6) == 0;
+    if (capture) {
+        indexCapture(index, p, p + size);
+    } else {
+        indexText(index, p, p + size);
+    }
+    bool ok = fclose(f) == 0;
+    if (verbose) {
+        fprintf(stderr, "%s: %u entries\n", path, index.entries);
+    }
+    return ok;
+}
+
+static bool convertFile(const char *name) {
+    int fd = open(name, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "n2kcap: %s: %s\n", name, strerror(errno));
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size == 0) {
+        fprintf(stderr, "n2kcap: %s: empty or unreadable\n", name);
+        close(fd);
+        return false;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "n2kcap: %s: %s\n", name, strerror(errno));
+        return false;
+    }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+    bool ok = makeIndex ? indexLog(name, (const uint8_t *)map, st.st_size)
+                        : convert(name, (const uint8_t *)map, st.st_size);
+    munmap(map, st.st_size);
+    return ok;
+}
+
+static void usage() {
+    fprintf(stderr, "usage: n2kcap [-f json|csv] [-d] [-v] file...\n");
+    fprintf(stderr, "       n2kcap -i [-v] file...\n");
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    int opt;
+    while ((opt = getopt(argc, argv, "f:dvi")) != -1) {
+        switch (opt) {
+            case 'f':
+                if (strcmp(optarg, "json") == 0) {
+                    format = FMT_JSON;
+                } else if (strcmp(optarg, "csv") == 0) {
+                    format = FMT_CSV;
+                } else {
+                    usage();
+                }
+                break;
+            case 'd':
+                decode = true;
+                break;
+            case 'v':
+                verbose = true;
+                break;
+            case 'i':
+                makeIndex = true;
+                break;
+            default:
+                usage();
+        }
+    }
+    if (optind >= argc) {
+        usage();
+    }
+
+    if (format == FMT_CSV) {
+        out.put(decode ? "ms,time,pgn,field,value\n" : "ms,time,pgn,src,dst,prio,len,data\n");
+    }
+    bool ok = true;
+    for (int i = optind; i < argc; i++) {
+        ok &= convertFile(argv[i]);
+    }
+    out.flush();
+
+    if (verbose && !makeIndex) {
+        fprintf(stderr, "%llu records, %llu decoded, %llu syncs, %llu CRC errors, %llu bytes skipped\n",
+                (unsigned long long)stats.records, (unsigned long long)stats.decoded,
+                (unsigned long long)stats.syncs, (unsigned long long)stats.crcErrors,
+                (unsigned long long)stats.skipped);
+    }
+    return ok ? 0 : 1;
+}
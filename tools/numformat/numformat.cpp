@@ -0,0 +1,270 @@
+// Round-trip test and benchmark for the number formatter
+/*
+Copyright (c) 2024 Peter Martin www.naiadhome.com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// Checks fmtFixed, fmtInt and fmtUint against printf for every scaled
+// value a meter or log field can reasonably hold, at every precision,
+// and at the ends of their ranges. fmtDouble and fmtValue are checked by
+// reading their output back with strtod: the text must be the nearest
+// value at that precision and must format to itself again. Truncation into
+// short buffers must never write past the end.
+// Then times fmtValue against String(double, 2) plus units, which is what
+// setMeter used before. The host String does the same formatting and
+// allocation as the Arduino one but runs on a faster heap, so the gap on
+// the ESP32 is bigger than the one shown here.
+//
+// Build and run from the top of the repo:
+//   g++ -O2 -std=gnu++11 -Itools/host -Isrc -o numformat
+//       tools/numformat/numformat.cpp src/NumFormat.cpp
+//   ./numformat [range]
+//
+// Exits non-zero on failure.
+
+#include <Arduino.h>
+#include <NumFormat.h>
+
+#include <chrono>
+
+static int failures;
+static int checks;
+
+// Reports only the first few failures, as a broken formatter fails millions
+#define CHECK(cond, ...)                                      \
+    do {                                                      \
+        checks++;                                             \
+        if (!(cond)) {                                        \
+            if (failures++ < 20) {                            \
+                fprintf(stderr, "%s:%d: FAILED ", __FILE__, __LINE__); \
+                fprintf(stderr, __VA_ARGS__);                 \
+                fprintf(stderr, "\n");                        \
+            }                                                 \
+        }                                                     \
+    } while (0)
+
+static const int64_t pow10[NUMF_MAX_DP + 1] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000};
+
+// What fmtFixed should write, made with printf
+static void refFixed(char *buf, size_t size, int64_t scaled, int dp) {
+    uint64_t mag = scaled < 0 ? -(uint64_t)scaled : scaled;
+    const char *sign = scaled < 0 ? "-" : "";
+    if (dp) {
+        snprintf(buf, size, "%s%llu.%0*llu", sign, (unsigned long long)(mag / pow10[dp]), dp,
+                 (unsigned long long)(mag % pow10[dp]));
+    } else {
+        snprintf(buf, size, "%s%llu", sign, (unsigned long long)mag);
+    }
+}
+
+static void testFixed(int64_t range) {
+    char out[48], ref[48];
+    int before = failures;
+    for (int dp = 0; dp <= NUMF_MAX_DP; dp++) {
+        for (int64_t k = -range; k <= range; k++) {
+            size_t n = fmtFixed(out, sizeof(out), k, dp);
+            refFixed(ref, sizeof(ref), k, dp);
+            if (strcmp(out, ref) || n != strlen(ref)) {
+                CHECK(false, "fmtFixed(%lld, %d) gave %s not %s", (long long)k, dp, out, ref);
+            }
+        }
+    }
+    static const int64_t edges[] = {INT64_MAX, INT64_MIN, INT64_MIN + 1, (int64_t)UINT32_MAX,
+                                    (int64_t)UINT32_MAX + 1, -(int64_t)UINT32_MAX - 1, 999999999999LL};
+    for (int64_t k : edges) {
+        for (int dp = 0; dp <= NUMF_MAX_DP; dp++) {
+            fmtFixed(out, sizeof(out), k, dp);
+            refFixed(ref, sizeof(ref), k, dp);
+            CHECK(!strcmp(out, ref), "fmtFixed(%lld, %d) gave %s not %s", (long long)k, dp, out, ref);
+        }
+    }
+    CHECK(failures == before, "fmtFixed over +-%lld", (long long)range);
+}
+
+static void testInts() {
+    char out[16], ref[16];
+    int before = failures;
+    // Every 16 bit value, then steps through the rest of the range
+    for (int64_t v = -70000; v <= 70000; v++) {
+        fmtInt(out, sizeof(out), v);
+        snprintf(ref, sizeof(ref), "%d", (int32_t)v);
+        CHECK(!strcmp(out, ref), "fmtInt(%d) gave %s", (int32_t)v, out);
+        fmtUint(out, sizeof(out), v);
+        snprintf(ref, sizeof(ref), "%u", (uint32_t)v);
+        CHECK(!strcmp(out, ref), "fmtUint(%u) gave %s", (uint32_t)v, out);
+    }
+    for (uint64_t v = 0; v <= UINT32_MAX; v += 65521) {
+        fmtUint(out, sizeof(out), v);
+        snprintf(ref, sizeof(ref), "%u", (uint32_t)v);
+        CHECK(!strcmp(out, ref), "fmtUint(%u) gave %s", (uint32_t)v, out);
+        fmtInt(out, sizeof(out), (int32_t)v);
+        snprintf(ref, sizeof(ref), "%d", (int32_t)v);
+        CHECK(!strcmp(out, ref), "fmtInt(%d) gave %s", (int32_t)v, out);
+    }
+    fmtInt(out, sizeof(out), INT32_MIN);
+    CHECK(!strcmp(out, "-2147483648"), "fmtInt(INT32_MIN) gave %s", out);
+    fmtUint(out, sizeof(out), UINT32_MAX);
+    CHECK(!strcmp(out, "4294967295"), "fmtUint(UINT32_MAX) gave %s", out);
+    CHECK(failures == before, "fmtInt and fmtUint");
+}
+
+// The decimal text at dp places nearest to value, allowing either side of a tie
+static bool nearest(const char *text, double value, int dp, double slack) {
+    char *end;
+    double back = strtod(text, &end);
+    if (*end) {
+        return false;
+    }
+    return fabs(back - value) <= 0.5 / pow10[dp] + slack;
+}
+
+static void testDouble() {
+    char out[32], again[32], ref[32];
+    int before = failures;
+    uint32_t rnd = 1;
+    for (int i = 0; i < 2000000; i++) {
+        rnd = rnd * 1103515245 + 12345;
+        int dp = rnd % (NUMF_MAX_DP + 1);
+        // Spread values over magnitudes from 1e-6 to 1e9
+        rnd = rnd * 1103515245 + 12345;
+        double value = ldexp((double)(rnd >> 1), (int)(rnd % 50) - 51);
+        if (rnd & 1) {
+            value = -value;
+        }
+        fmtDouble(out, sizeof(out), value, dp);
+        CHECK(nearest(out, value, dp, fabs(value) * 1e-15), "fmtDouble(%.17g, %d) gave %s", value, dp, out);
+        // Reading it back and formatting again gives the same text
+        fmtDouble(again, sizeof(again), strtod(out, NULL), dp);
+        CHECK(!strcmp(out, again), "fmtDouble(%s, %d) gave %s", out, dp, again);
+        // printf only differs on ties, which it rounds to even
+        snprintf(ref, sizeof(ref), "%.*f", dp, value);
+        if (!strcmp(ref, "-0") || !strncmp(ref, "-0.", 3)) {
+            // fmtDouble does not write negative zero
+            if (strspn(ref + 1, "0.") == strlen(ref + 1)) {
+                memmove(ref, ref + 1, strlen(ref));
+            }
+        }
+        double frac = fabs(value) * pow10[dp];
+        bool tie = fabs(frac - floor(frac) - 0.5) < 1e-6;
+        CHECK(tie || !strcmp(out, ref), "fmtDouble(%.17g, %d) gave %s not %s", value, dp, out, ref);
+    }
+    fmtDouble(out, sizeof(out), NAN, 2);
+    CHECK(!strcmp(out, "null"), "fmtDouble(NAN) gave %s", out);
+    fmtDouble(out, sizeof(out), 1e300, 2);
+    CHECK(!strcmp(out, "null"), "fmtDouble(1e300) gave %s", out);
+    fmtDouble(out, sizeof(out), 2.5, 0);
+    CHECK(!strcmp(out, "3"), "fmtDouble(2.5, 0) gave %s", out);
+    fmtDouble(out, sizeof(out), -2.5, 0);
+    CHECK(!strcmp(out, "-3"), "fmtDouble(-2.5, 0) gave %s", out);
+    CHECK(failures == before, "fmtDouble");
+}
+
+static void testValue() {
+    char out[32];
+    int before = failures;
+    // Every value a meter shows, from -1000 to 1000 in steps of 0.001
+    for (int k = -1000000; k <= 1000000; k++) {
+        float value = k / 1000.0f;
+        for (int dp = 0; dp <= 3; dp++) {
+            size_t n = fmtValue(out, sizeof(out), value, dp, 7, "kts");
+            CHECK(n == strlen(out) && n >= 10, "fmtValue(%g, %d) gave \"%s\"", value, dp, out);
+            CHECK(!strcmp(out + n - 3, "kts"), "fmtValue(%g, %d) gave \"%s\"", value, dp, out);
+            // Right aligned to seven characters before the units
+            CHECK(n > 10 || out[0] != ' ' || out[6] != ' ', "fmtValue(%g, %d) gave \"%s\"", value, dp, out);
+            out[n - 3] = 0;
+            const char *number = out + strspn(out, " ");
+            CHECK(nearest(number, value, dp, fabs(value) * 1.2e-7), "fmtValue(%.9g, %d) gave \"%s\"", value, dp,
+                  out);
+        }
+    }
+    fmtValue(out, sizeof(out), NAN, 1, 5, "V");
+    CHECK(!strcmp(out, "  ---V"), "fmtValue(NAN) gave \"%s\"", out);
+    fmtValue(out, sizeof(out), 9.5f, 1, 5, "kts");
+    CHECK(!strcmp(out, "  9.5kts"), "fmtValue(9.5) gave \"%s\"", out);
+    CHECK(failures == before, "fmtValue");
+}
+
+// Short buffers are filled and terminated but never overrun
+static void testTruncation() {
+    char buf[40];
+    const char *full = "   -12.81kts";
+    for (size_t size = 0; size < 16; size++) {
+        memset(buf, '#', sizeof(buf));
+        size_t n = fmtValue(buf, size, -12.81f, 2, 9, "kts");
+        CHECK(buf[size] == '#', "fmtValue wrote past %zu bytes", size);
+        if (size) {
+            size_t want = size - 1 < strlen(full) ? size - 1 : strlen(full);
+            CHECK(n == want && !strncmp(buf, full, n) && !buf[n], "fmtValue into %zu bytes gave \"%s\"", size, buf);
+        }
+        memset(buf, '#', sizeof(buf));
+        fmtFixed(buf, size, -1234567, 3);
+        CHECK(buf[size] == '#', "fmtFixed wrote past %zu bytes", size);
+        memset(buf, '#', sizeof(buf));
+        fmtDouble(buf, size, NAN, 3);
+        CHECK(buf[size] == '#', "fmtDouble wrote past %zu bytes", size);
+    }
+}
+
+static double nowSecs() {
+    using namespace std::chrono;
+    return duration_cast<duration<double>>(steady_clock::now().time_since_epoch()).count();
+}
+
+static size_t sink;
+
+static void benchmark() {
+    const int count = 2000000;
+    float values[1024];
+    for (int i = 0; i < 1024; i++) {
+        values[i] = (i * 37 % 2000) / 7.0f - 100;
+    }
+
+    double start = nowSecs();
+    for (int i = 0; i < count; i++) {
+        String text = String(values[i & 1023], 2) + "kts";
+        sink += text.length();
+    }
+    double stringSecs = nowSecs() - start;
+
+    char buf[24];
+    start = nowSecs();
+    for (int i = 0; i < count; i++) {
+        sink += fmtValue(buf, sizeof(buf), values[i & 1023], 2, 7, "kts");
+    }
+    double fmtSecs = nowSecs() - start;
+
+    printf("String(double, 2)  %6.1f ns per value\n", stringSecs * 1e9 / count);
+    printf("fmtValue           %6.1f ns per value\n", fmtSecs * 1e9 / count);
+    printf("(checksum %zu)\n", sink);
+}
+
+int main(int argc, char **argv) {
+    int64_t range = argc > 1 ? strtoll(argv[1], NULL, 0) : 2000000;
+    testFixed(range);
+    testInts();
+    testDouble();
+    testValue();
+    testTruncation();
+    printf("%d checks, %d failed\n", checks, failures);
+    if (failures) {
+        return 1;
+    }
+    benchmark();
+    return 0;
+}
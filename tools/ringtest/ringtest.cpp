@@ -0,0 +1,159 @@
+// Two thread stress test of SpscRing
+/*
+Copyright (c) 2024 Peter Martin www.naiadhome.com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// A producer thread fills the ring as fast as it can, half the time with
+// push and half with claim and publish, while a consumer thread empties it.
+// Each item carries a sequence number and a pattern made from it, so the
+// consumer can check that nothing arrives twice, out of order or torn.
+// Most items are tried again until they go in, so the ring runs full and
+// empty many times. Every eighth is only tried once, so some are refused.
+// Every item must be either received or counted as an overflow.
+//
+// Build and run from the top of the repo:
+//   g++ -O2 -g -std=gnu++11 -pthread -Isrc -o ringtest tools/ringtest/ringtest.cpp
+//   ./ringtest [items]
+// Building with -fsanitize=thread as well checks the memory ordering.
+
+#include <SpscRing.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <thread>
+
+struct Item {
+    uint32_t seq;
+    uint32_t words[15];     // Big enough that a torn copy would show
+};
+
+static uint32_t pattern(uint32_t seq, int i) {
+    return seq * 2654435761u + i;
+}
+
+template <size_t N>
+static int stress(uint32_t count) {
+    static SpscRing<Item, N> ring;
+    std::atomic<bool> done{false};
+    uint32_t sent = 0, refused = 0, dropped = 0;
+    uint32_t received = 0, bad = 0, gaps = 0;
+
+    // Put one item in, by push or by claim and publish
+    auto offer = [&](uint32_t seq) {
+        if (seq & 1) {
+            Item item;
+            item.seq = seq;
+            for (int i = 0; i < 15; i++) {
+                item.words[i] = pattern(seq, i);
+            }
+            return ring.push(item);
+        }
+        Item *slot = ring.claim();
+        if (!slot) {
+            return false;
+        }
+        slot->seq = seq;
+        for (int i = 0; i < 15; i++) {
+            slot->words[i] = pattern(seq, i);
+        }
+        ring.publish();
+        return true;
+    };
+
+    // Both threads start together
+    std::atomic<int> ready{0};
+    std::thread producer([&] {
+        ready++;
+        while (ready.load() < 2) {
+            std::this_thread::yield();
+        }
+        for (uint32_t seq = 0; seq < count; seq++) {
+            bool in;
+            while (!(in = offer(seq))) {
+                refused++;
+                if ((seq & 7) == 0) {
+                    break;
+                }
+                std::this_thread::yield();
+            }
+            if (in) {
+                sent++;
+            } else {
+                dropped++;
+            }
+        }
+        done.store(true, std::memory_order_release);
+    });
+
+    std::thread consumer([&] {
+        ready++;
+        while (ready.load() < 2) {
+            std::this_thread::yield();
+        }
+        int64_t last = -1;
+        for (;;) {
+            Item *item = ring.front();
+            if (!item) {
+                if (done.load(std::memory_order_acquire) && !ring.front()) {
+                    break;
+                }
+                std::this_thread::yield();
+                continue;
+            }
+            if ((int64_t)item->seq <= last) {
+                bad++;
+            } else if ((int64_t)item->seq != last + 1) {
+                gaps++;     // Allowed, the items in between were dropped
+            }
+            for (int i = 0; i < 15; i++) {
+                if (item->words[i] != pattern(item->seq, i)) {
+                    bad++;
+                    break;
+                }
+            }
+            last = item->seq;
+            received++;
+            ring.pop();
+        }
+    });
+
+    producer.join();
+    consumer.join();
+
+    bool ok = bad == 0 && received == sent && refused == ring.overflows.load() && sent + dropped == count &&
+              gaps <= dropped && ring.highWater.load() <= ring.capacity() && ring.size() == 0;
+    printf("N=%-5zu %u sent, %u received, %u dropped, %u refused (%u counted), %u gaps, "
+           "high water %u of %zu, %u bad: %s\n",
+           N, sent, received, dropped, refused, ring.overflows.load(), gaps, ring.highWater.load(),
+           ring.capacity(), bad, ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+    uint32_t count = argc > 1 ? strtoul(argv[1], NULL, 0) : 2000000;
+    int failed = 0;
+    failed += stress<2>(count / 8);
+    failed += stress<16>(count);
+    failed += stress<64>(count);
+    failed += stress<1024>(count);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,92 @@
+// Test of the fixed point sky view geometry
+/*
+Copyright (c) 2024 Peter Martin www.naiadhome.com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// Checks the satellite positions from skyOffset against the same sums
+// done in double precision, as setGNSSSky did before the lookup table,
+// for every azimuth and declination in tenths of a degree and for sky
+// views from small to larger than the display. Every position must be
+// within one pixel. Also reports the worst error of isin and icos.
+//
+// Build and run from the top of the repo:
+//   g++ -O2 -std=gnu++11 -Isrc -o skytrig tools/skytrig/skytrig.cpp
+//   ./skytrig
+//
+// Exits non-zero on failure.
+
+#include <SkyTrig.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static int failures;
+static int checks;
+
+static double degToRad(double deg) {
+    return deg * M_PI / 180;
+}
+
+int main() {
+    // The table itself, in units of 2^-14
+    double worst = 0;
+    for (int32_t t = -3600; t <= 7200; t++) {
+        double s = fabs(isin(t) - 16384 * sin(degToRad(t / 10.0)));
+        double c = fabs(icos(t) - 16384 * cos(degToRad(t / 10.0)));
+        worst = fmax(worst, fmax(s, c));
+    }
+    checks++;
+    if (worst > 4) {
+        failures++;
+        printf("isin and icos are out by up to %.1f / 16384\n", worst);
+    }
+    printf("isin and icos within %.2f / 16384\n", worst);
+
+    // The sky view on the display has a radius of about 100 pixels
+    static const int32_t radii[] = {20, 64, 100, 113, 160, 240};
+    for (int32_t radius : radii) {
+        double worstPixel = 0;
+        for (int dec = 0; dec <= 900; dec++) {
+            for (int az = 0; az <= 3600; az++) {
+                double azimuth = az / 10.0;
+                double declination = dec / 10.0;
+                int32_t x, y;
+                skyOffset(radius, azimuth, declination, x, y);
+                double rad = radius * cos(degToRad(declination));
+                double dx = rad * sin(degToRad(azimuth));
+                double dy = rad * cos(degToRad(azimuth));
+                double err = fmax(fabs(x - dx), fabs(y - dy));
+                worstPixel = fmax(worstPixel, err);
+                checks++;
+                if (fabs(x - lround(dx)) > 1 || fabs(y - lround(dy)) > 1) {
+                    if (failures++ < 20) {
+                        printf("radius %d az %.1f dec %.1f gave %d,%d not %.2f,%.2f\n", radius, azimuth,
+                               declination, x, y, dx, dy);
+                    }
+                }
+            }
+        }
+        printf("radius %3d within %.2f pixels\n", radius, worstPixel);
+    }
+
+    printf("%d checks, %d failed\n", checks, failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,213 @@
+// Benchmark of the YD RAW line parser against the old strtok_r parser
+/*
+Copyright (c) 2024 Peter Martin www.naiadhome.com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// Times YDtoN2kUDP::parseLine against the tokenize and strtoul parser it
+// replaced, over a YD RAW log, and checks both give the same messages.
+// Without a file a log with a typical mix of PGNs is made up.
+//
+// Build and run from the top of the repo:
+//   g++ -O2 -std=gnu++11 -Itools/host -Isrc -o ydbench
+//       tools/ydbench/ydbench.cpp src/YDtoN2kUDP.cpp src/PgnFilter.cpp
+//   ./ydbench [yd-log] [passes]
+//
+// A log can be captured from the gateway with eg
+//   nc -u -l 1457 > yd.log
+
+#include <Arduino.h>
+#include <YDtoN2kUDP.h>
+
+#include <string>
+#include <vector>
+
+// The old parser, as it was in readYD, for one datagram holding one line
+static bool oldParse(char *packetBuffer, tN2kMsg &msgout) {
+    char *word;
+    const char *sep = " ";
+    char *lasts;
+    int i = 0;
+    const uint16_t maxwords = 64;
+    const uint16_t maxlen = 16;
+    char words[maxwords][maxlen];
+
+    for (word = strtok_r(packetBuffer, sep, &lasts); word && i < maxwords;
+         word = strtok_r(NULL, sep, &lasts), i++) {
+        strncpy(words[i], word, maxlen - 1);
+    }
+    if (i > 2) {
+        uint32_t canId = strtoul((const char *)words[2], NULL, 16);
+        uint32_t len = i - 3;
+        msgout.Source = canId & 0xff;
+        msgout.Priority = (canId >> 26) & 0x7;
+        msgout.SetPGN((canId >> 8) & 0x3ffff);
+        msgout.DataLen = len;
+        for (uint32_t j = 0; j < len; j++) {
+            msgout.Data[j] = strtoul((const char *)words[j + 3], NULL, 16) & 0xff;
+        }
+        return true;
+    }
+    return false;
+}
+
+// A made up log. Rates are roughly those seen on a small boat's network.
+static std::string makeLog(int lines) {
+    static const struct {
+        uint32_t pgn;
+        int weight;
+    } mix[] = {
+        {127250, 10}, {127251, 10}, {127257, 10}, {128259, 2}, {128267, 1}, {129025, 10},
+        {129026, 4},  {129029, 8},  {129540, 6},  {130306, 10}, {127488, 10}, {127508, 1},
+        {130310, 1},  {130312, 1},  {130313, 1},  {130314, 1},  {126992, 1},  {129539, 1},
+    };
+    int total = 0;
+    for (auto &m : mix) {
+        total += m.weight;
+    }
+    std::string log;
+    char line[80];
+    uint32_t rnd = 12345;
+    for (int n = 0; n < lines; n++) {
+        rnd = rnd * 1103515245 + 12345;
+        int pick = (rnd >> 8) % total;
+        size_t k = 0;
+        while (pick >= mix[k].weight) {
+            pick -= mix[k++].weight;
+        }
+        uint32_t canId = (2u << 26) | (mix[k].pgn << 8) | (0x10 + k);
+        int at = snprintf(line, sizeof(line), "%02d:%02d:%02d.%03d R %08X", n / 3600000 % 24,
+                          n / 60000 % 60, n / 1000 % 60, n % 1000, canId);
+        for (int b = 0; b < 8; b++) {
+            rnd = rnd * 1103515245 + 12345;
+            at += snprintf(line + at, sizeof(line) - at, " %02X", (rnd >> 16) & 0xff);
+        }
+        snprintf(line + at, sizeof(line) - at, "\r\n");
+        log += line;
+    }
+    return log;
+}
+
+static std::string readFile(const char *name) {
+    std::string data;
+    FILE *f = fopen(name, "rb");
+    if (!f) {
+        perror(name);
+        exit(1);
+    }
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        data.append(buf, n);
+    }
+    fclose(f);
+    return data;
+}
+
+static double nowSecs() {
+    using namespace std::chrono;
+    return duration_cast<duration<double>>(steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char **argv) {
+    std::string log = argc > 1 ? readFile(argv[1]) : makeLog(20000);
+    int passes = argc > 2 ? atoi(argv[2]) : 20;
+
+    // Split into lines once, as each used to arrive in its own datagram
+    std::vector<std::string> lines;
+    size_t start = 0;
+    while (start < log.size()) {
+        size_t end = log.find('\n', start);
+        if (end == std::string::npos) {
+            end = log.size();
+        }
+        std::string line = log.substr(start, end - start);
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) {
+            line.pop_back();
+        }
+        if (!line.empty()) {
+            lines.push_back(line);
+        }
+        start = end + 1;
+    }
+    printf("%zu lines, %d passes\n", lines.size(), passes);
+
+    // Both must give the same messages. The old parser left the PDU1
+    // destination in the PGN so only the CAN id fields are compared.
+    size_t mismatches = 0, malformed = 0;
+    for (const std::string &line : lines) {
+        tN2kMsg a, b;
+        const char *p = line.c_str();
+        YDResult r = YDtoN2kUDP::parseLine(p, p + line.size(), a);
+        std::vector<char> copy(line.begin(), line.end());
+        copy.push_back('\0');
+        bool ok = oldParse(copy.data(), b);
+        if (r != YD_OK) {
+            malformed++;
+            continue;
+        }
+        uint32_t oldPgn = b.PGN;
+        if (((oldPgn >> 8) & 0xff) < 240) {
+            oldPgn &= 0x3ff00;
+        }
+        if (!ok || a.PGN != oldPgn || a.Source != b.Source || a.Priority != b.Priority ||
+            a.DataLen != b.DataLen || memcmp(a.Data, b.Data, a.DataLen) != 0) {
+            mismatches++;
+        }
+    }
+    printf("%zu malformed, %zu differ from the old parser\n", malformed, mismatches);
+
+    // Old: each line copied to a buffer as the UDP read did, then tokenized
+    char packet[N2K_PKT_SIZE + 1];
+    tN2kMsg msg;
+    uint32_t sum = 0;
+    double t0 = nowSecs();
+    for (int pass = 0; pass < passes; pass++) {
+        for (const std::string &line : lines) {
+            memcpy(packet, line.c_str(), line.size() + 1);
+            if (oldParse(packet, msg)) {
+                sum += msg.Data[0];
+            }
+        }
+    }
+    double oldSecs = nowSecs() - t0;
+
+    // New: the whole log walked in place, as a datagram of many lines is
+    t0 = nowSecs();
+    for (int pass = 0; pass < passes; pass++) {
+        const char *p = log.c_str();
+        const char *end = p + log.size();
+        while (p < end) {
+            if (*p == '\r' || *p == '\n') {
+                p++;
+                continue;
+            }
+            if (YDtoN2kUDP::parseLine(p, end, msg) == YD_OK) {
+                sum += msg.Data[0];
+            }
+        }
+    }
+    double newSecs = nowSecs() - t0;
+
+    double frames = (double)lines.size() * passes;
+    printf("old strtok_r  %10.0f frames/s\n", frames / oldSecs);
+    printf("parseLine     %10.0f frames/s, %.1fx\n", frames / newSecs, oldSecs / newSecs);
+    printf("(checksum %u)\n", sum);
+    return mismatches ? 1 : 0;
+}